@@ -7,7 +7,8 @@
 //
 // Interface:
 // * To get a buffer for a particular disk block, call bread.
-// * After changing buffer data, call bwrite to write it to disk.
+// * After changing buffer data, call bwrite to write it to disk,
+//     or log_write to have the log write it later.
 // * When done with the buffer, call brelse.
 // * Do not use the buffer after calling brelse.
 // * Only one process at a time can use a buffer,
@@ -19,9 +20,13 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "riscv.h"
+#include "rusage.h"
+#include "proc.h"
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
+#include "stat.h"
+#include "trace.h"
 
 struct {
   struct spinlock lock;
@@ -31,6 +36,9 @@ struct {
   // Sorted by how recently the buffer was used.
   // head.next is most recent, head.prev is least.
   struct buf head;
+
+  uint64 nhit;
+  uint64 nmiss;
 } bcache;
 
 void
@@ -65,6 +73,7 @@ bget(uint dev, uint blockno)
   // Is the block already cached?
   for(b = bcache.head.next; b != &bcache.head; b = b->next){
     if(b->dev == dev && b->blockno == blockno){
+      bcache.nhit++;
       b->refcnt++;
       release(&bcache.lock);
       acquiresleep(&b->lock);
@@ -74,6 +83,8 @@ bget(uint dev, uint blockno)
 
   // Not cached.
   // Recycle the least recently used (LRU) unused buffer.
+  bcache.nmiss++;
+  TRACE(TR_BMISS, blockno, dev);
   for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
     if(b->refcnt == 0) {
       b->dev = dev;
@@ -96,6 +107,8 @@ bread(uint dev, uint blockno)
 
   b = bget(dev, blockno);
   if(!b->valid) {
+    if(myproc())
+      myproc()->ru.inblock++;
     virtio_disk_rw(b, 0);
     b->valid = 1;
   }
@@ -108,13 +121,16 @@ bwrite(struct buf *b)
 {
   if(!holdingsleep(&b->lock))
     panic("bwrite");
+  if(myproc())
+    myproc()->ru.oublock++;
   virtio_disk_rw(b, 1);
 }
 
 // Release a locked buffer.
-// Move to the head of the most-recently-used list.
-void
-brelse(struct buf *b)
+// Move to the head of the most-recently-used list,
+// or to the tail if cold.
+static void
+relse(struct buf *b, int cold)
 {
   if(!holdingsleep(&b->lock))
     panic("brelse");
@@ -127,15 +143,36 @@ brelse(struct buf *b)
     // no one is waiting for it.
     b->next->prev = b->prev;
     b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    if(cold){
+      b->prev = bcache.head.prev;
+      b->next = &bcache.head;
+      bcache.head.prev->next = b;
+      bcache.head.prev = b;
+    } else {
+      b->next = bcache.head.next;
+      b->prev = &bcache.head;
+      bcache.head.next->prev = b;
+      bcache.head.next = b;
+    }
   }
   
   release(&bcache.lock);
 }
 
+void
+brelse(struct buf *b)
+{
+  relse(b, 0);
+}
+
+// Release a buffer whose contents are also in the page cache,
+// so that it is recycled before metadata blocks are.
+void
+brelsecold(struct buf *b)
+{
+  relse(b, 1);
+}
+
 void
 bpin(struct buf *b) {
   acquire(&bcache.lock);
@@ -150,4 +187,18 @@ bunpin(struct buf *b) {
   release(&bcache.lock);
 }
 
+// Fill in the buffer cache's counters in cs.
+void
+bstat(struct cachestat *cs)
+{
+  struct buf *b;
 
+  acquire(&bcache.lock);
+  cs->bhit = bcache.nhit;
+  cs->bmiss = bcache.nmiss;
+  cs->ndirty = 0;
+  for(b = bcache.buf; b < bcache.buf+NBUF; b++)
+    if(b->dirty)
+      cs->ndirty++;
+  release(&bcache.lock);
+}
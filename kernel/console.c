@@ -17,9 +17,12 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "file.h"
+#include "fcntl.h"
+#include "poll.h"
 #include "memlayout.h"
 #include "riscv.h"
 #include "defs.h"
+#include "rusage.h"
 #include "proc.h"
 
 #define BACKSPACE 0x100
@@ -50,6 +53,8 @@ struct {
   uint r;  // Read index
   uint w;  // Write index
   uint e;  // Edit index
+
+  struct pollwaiter *pollq;  // poll()s waiting for input
 } cons;
 
 //
@@ -75,9 +80,11 @@ consolewrite(int user_src, uint64 src, int n)
 // copy (up to) a whole input line to dst.
 // user_dist indicates whether dst is a user
 // or kernel address.
+// if nonblock, return what there is, or
+// EAGAIN if there is nothing, instead of waiting.
 //
 int
-consoleread(int user_dst, uint64 dst, int n)
+consoleread(int user_dst, uint64 dst, int n, int nonblock)
 {
   uint target;
   int c;
@@ -93,6 +100,10 @@ consoleread(int user_dst, uint64 dst, int n)
         release(&cons.lock);
         return -1;
       }
+      if(nonblock){
+        release(&cons.lock);
+        return n < target ? target - n : EAGAIN;
+      }
       sleep(&cons.r, &cons.lock);
     }
 
@@ -126,6 +137,27 @@ consoleread(int user_dst, uint64 dst, int n)
   return target - n;
 }
 
+//
+// user poll()s of the console come here.
+// input is ready once a whole line has arrived;
+// output is always ready.
+//
+int
+consolepoll(int events, struct pollwaiter *w, int *woken)
+{
+  int r;
+
+  acquire(&cons.lock);
+  r = POLLOUT;
+  if(cons.r != cons.w)
+    r |= POLLIN;
+  r &= events;
+  if(r == 0 && w)
+    pollwait(w, &cons.pollq, &cons.lock, woken);
+  release(&cons.lock);
+  return r;
+}
+
 //
 // the console input interrupt handler.
 // uartintr() calls this for input character.
@@ -170,6 +202,7 @@ consoleintr(int c)
         // has arrived.
         cons.w = cons.e;
         wakeup(&cons.r);
+        pollwake(&cons.pollq);
       }
     }
     break;
@@ -189,4 +222,5 @@ consoleinit(void)
   // to consoleread and consolewrite.
   devsw[CONSOLE].read = consoleread;
   devsw[CONSOLE].write = consolewrite;
+  devsw[CONSOLE].poll = consolepoll;
 }
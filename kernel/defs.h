@@ -1,21 +1,32 @@
 struct buf;
+struct cachestat;
 struct context;
+struct cpage;
 struct file;
 struct inode;
 struct pipe;
+struct pollwaiter;
 struct proc;
+struct rusage;
+struct usqe;
+struct timer;
 struct spinlock;
 struct sleeplock;
 struct stat;
+struct dirent;
+struct dirstat;
+struct iovec;
 struct superblock;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
+void            brelsecold(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+void            bstat(struct cachestat*);
 
 // console.c
 void            consoleinit(void);
@@ -33,12 +44,17 @@ void            fileinit(void);
 int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
 int             filewrite(struct file*, uint64, int n);
+int             filegetdents(struct file*, uint64, int n);
+int             filereadv(struct file*, struct iovec*, int, int);
+int             filewritev(struct file*, struct iovec*, int, int);
+int             filecopy(struct file*, struct file*, int);
+int             filepoll(struct file*, int, struct pollwaiter*, int*);
 
 // fs.c
 void            fsinit(int);
 int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
-struct inode*   ialloc(uint, short);
+struct inode*   ialloc(uint, short, uint);
 struct inode*   idup(struct inode*);
 void            iinit();
 void            ilock(struct inode*);
@@ -49,10 +65,14 @@ void            iupdate(struct inode*);
 int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
+struct inode*   nameiat(struct inode*, char*);
+struct inode*   nameiparentat(struct inode*, char*, char*);
 int             readi(struct inode*, int, uint64, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, int, uint64, uint, uint);
+void            direntstat(struct inode*, struct dirent*, struct dirstat*);
 void            itrunc(struct inode*);
+int             iextend(struct inode*, uint, int);
 
 // ramdisk.c
 void            ramdiskinit(void);
@@ -69,12 +89,28 @@ void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
 void            begin_op(void);
 void            end_op(void);
+void            log_sync(void);
+
+// pcache.c
+void            pcinit(void);
+struct cpage*   pcget(uint, uint, uint);
+struct cpage*   pclookup(uint, uint, uint);
+void            pcput(struct cpage*);
+void            pcinval(uint, uint);
+void            pcstat(struct cachestat*);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
-int             piperead(struct pipe*, uint64, int);
-int             pipewrite(struct pipe*, uint64, int);
+int             piperead(struct pipe*, uint64, int, int);
+int             pipewrite(struct pipe*, int, uint64, int, int);
+int             pipepoll(struct pipe*, int, int, int, struct pollwaiter*, int*);
+
+// poll.c
+void            pollinit(void);
+void            pollwait(struct pollwaiter*, struct pollwaiter**, struct spinlock*, int*);
+void            pollwake(struct pollwaiter**);
+int             poll(uint64, int, int);
 
 // printf.c
 void            printf(char*, ...);
@@ -85,7 +121,17 @@ void            printfinit(void);
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
-int             growproc(int);
+int             growproc(int, uint64*);
+int             clone(uint64, uint64, uint64);
+int             join(int, uint64);
+struct file*    fdget(int);
+void            fdput(void);
+int             fdalloc(struct file*);
+struct file*    fdremove(int);
+struct inode*   cwdget(void);
+struct inode*   cwdset(struct inode*);
+int             futexwait(uint64, int);
+int             futexwake(uint64, int);
 void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
@@ -97,13 +143,31 @@ void            procinit(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            sleep(void*, struct spinlock*);
+void            sleepuntil(void*, struct spinlock*, uint64);
+void            wakeidle(struct proc*);
 void            userinit(void);
+int             kthread(char*, void (*)(void), int);
+int             kclone(char*, void (*)(void));
+void            killthreads(struct proc*);
 int             wait(uint64);
 void            wakeup(void*);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
+void            rucharge(struct proc*, int);
+void            hpmcharge(struct proc*, int);
+void            ruadd(struct rusage*, struct rusage*);
+int             procinfo(uint64, int);
+
+// sysfile.c
+int             uringop(struct usqe*);
+
+// uring.c
+void            uringinit(void);
+uint64          uringsetup(void);
+void            uringfree(struct proc*, pagetable_t);
+int             uringenter(int, int);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -138,14 +202,35 @@ int             argaddr(int, uint64 *);
 int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
+int             sysstat(int, uint64, int);
 
 // trap.c
-extern uint     ticks;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
 
+// prof.c
+extern int      profiling;
+void            profinit(void);
+void            profsample(int, uint64, uint64);
+int             prof(int, uint64, int);
+
+// trace.c
+extern int      tracing;
+void            traceinit(void);
+void            tracerec(int, int, int);
+int             ktrace(int, uint64, int);
+// record a trace event; costs one test when tracing is off.
+#define TRACE(type, a, b) do { if(tracing) tracerec(type, a, b); } while(0)
+
+// timer.c
+void            wheelinit(void);
+void            timerarm(void);
+void            timer_add(struct timer*, uint64, void*);
+void            timer_del(struct timer*);
+int             timerintr(void);
+
 // uart.c
 void            uartinit(void);
 void            uartintr(void);
@@ -166,6 +251,7 @@ int             uvmcopy(pagetable_t, pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
+pte_t *         walk(pagetable_t, uint64, int);
 uint64          walkaddr(pagetable_t, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
 int             copyin(pagetable_t, char *, uint64, uint64);
@@ -182,5 +268,11 @@ void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
 void            virtio_disk_intr(void);
 
+// workq.c
+void            workqinit(void);
+void            workqinithart(void);
+int             workq_add(void (*)(uint64, uint64), uint64, uint64);
+void            workq_drain(void);
+
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -3,3 +3,34 @@
 #define O_RDWR    0x002
 #define O_CREATE  0x200
 #define O_TRUNC   0x400
+#define O_NONBLOCK 0x800
+
+// fcntl() commands.
+#define F_GETFL   3    // return the O_ flags
+#define F_SETFL   4    // set O_NONBLOCK from arg
+
+// returned by read() or write() of an O_NONBLOCK
+// pipe or console that would otherwise have slept.
+#define EAGAIN    (-2)
+
+// dirfd for the *at() calls meaning the current directory.
+#define AT_FDCWD  -100
+
+// One buffer of a readv() or writev() call.
+struct iovec {
+  void *iov_base;
+  uint64 iov_len;
+};
+
+// One file of a poll() call.
+struct pollfd {
+  int fd;         // ignored if negative
+  short events;   // POLLIN and/or POLLOUT
+  short revents;  // which are ready; the others are always reported
+};
+
+#define POLLIN    0x001  // read will not block
+#define POLLOUT   0x004  // write will not block
+#define POLLERR   0x008  // pipe has no reader
+#define POLLHUP   0x010  // pipe has no writer
+#define POLLNVAL  0x020  // fd is not open
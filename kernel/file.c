@@ -11,7 +11,9 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "stat.h"
+#include "rusage.h"
 #include "proc.h"
+#include "fcntl.h"
 
 struct devsw devsw[NDEV];
 struct {
@@ -35,6 +37,7 @@ filealloc(void)
   for(f = ftable.file; f < ftable.file + NFILE; f++){
     if(f->ref == 0){
       f->ref = 1;
+      f->nonblock = 0;
       release(&ftable.lock);
       return f;
     }
@@ -101,32 +104,90 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
+// Return which of events (POLLIN, POLLOUT) are ready on f, and
+// any of POLLERR and POLLHUP that apply.  If there are none, and
+// w is not 0, queue w so that *woken is set when f may have
+// become ready (see poll.c).
+int
+filepoll(struct file *f, int events, struct pollwaiter *w, int *woken)
+{
+  int r;
+
+  if(f->type == FD_PIPE)
+    return pipepoll(f->pipe, f->readable, f->writable, events, w, woken);
+  if(f->type == FD_DEVICE && f->major >= 0 && f->major < NDEV && devsw[f->major].poll)
+    return devsw[f->major].poll(events, w, woken);
+
+  // files never block.
+  r = 0;
+  if(f->readable)
+    r |= POLLIN;
+  if(f->writable)
+    r |= POLLOUT;
+  return r & events;
+}
+
 // Read from file f.
 // addr is a user virtual address.
 int
 fileread(struct file *f, uint64 addr, int n)
 {
-  int r = 0;
+  struct iovec iov;
+
+  if(n < 0)
+    return -1;
+  iov.iov_base = (void*)addr;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, -1);
+}
+
+// Read from file f into the iovcnt user buffers described by iov,
+// filling each before moving on to the next.  Reads at offset off,
+// or at f->off, advancing it, if off is -1.  Pipes and devices have
+// no offset.
+int
+filereadv(struct file *f, struct iovec *iov, int iovcnt, int off)
+{
+  int i, r, tot, adv;
 
   if(f->readable == 0)
     return -1;
 
-  if(f->type == FD_PIPE){
-    r = piperead(f->pipe, addr, n);
-  } else if(f->type == FD_DEVICE){
+  if(f->type == FD_PIPE || f->type == FD_DEVICE){
+    if(off != -1)
+      return -1;
+    // reading a second buffer could block even though the first
+    // was filled, so only the first non-empty one is used.
+    for(i = 0; i < iovcnt && iov[i].iov_len == 0; i++)
+      ;
+    if(i == iovcnt)
+      return 0;
+    if(f->type == FD_PIPE)
+      return piperead(f->pipe, (uint64)iov[i].iov_base, iov[i].iov_len, f->nonblock);
     if(f->major < 0 || f->major >= NDEV || !devsw[f->major].read)
       return -1;
-    r = devsw[f->major].read(1, addr, n);
+    return devsw[f->major].read(1, (uint64)iov[i].iov_base, iov[i].iov_len, f->nonblock);
   } else if(f->type == FD_INODE){
     ilock(f->ip);
-    if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
-      f->off += r;
+    if((adv = (off == -1)))
+      off = f->off;
+    tot = 0;
+    for(i = 0; i < iovcnt; i++){
+      if((r = readi(f->ip, 1, (uint64)iov[i].iov_base, off + tot, iov[i].iov_len)) < 0){
+        if(tot == 0)
+          tot = -1;
+        break;
+      }
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    if(adv && tot > 0)
+      f->off += tot;
     iunlock(f->ip);
-  } else {
-    panic("fileread");
+    return tot;
   }
-
-  return r;
+  panic("fileread");
 }
 
 // Write to file f.
@@ -134,17 +195,46 @@ fileread(struct file *f, uint64 addr, int n)
 int
 filewrite(struct file *f, uint64 addr, int n)
 {
-  int r, ret = 0;
+  struct iovec iov;
+
+  if(n < 0)
+    return -1;
+  iov.iov_base = (void*)addr;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, -1);
+}
+
+// Write the iovcnt user buffers described by iov to file f, one
+// after the other.  Writes at offset off, or at f->off, advancing
+// it, if off is -1.  Pipes and devices have no offset.
+int
+filewritev(struct file *f, struct iovec *iov, int iovcnt, int off)
+{
+  int i, r, n, n1, pos, tot;
+  uint64 done;
 
   if(f->writable == 0)
     return -1;
 
-  if(f->type == FD_PIPE){
-    ret = pipewrite(f->pipe, addr, n);
-  } else if(f->type == FD_DEVICE){
-    if(f->major < 0 || f->major >= NDEV || !devsw[f->major].write)
+  if(f->type == FD_PIPE || f->type == FD_DEVICE){
+    if(off != -1)
+      return -1;
+    if(f->type == FD_DEVICE &&
+       (f->major < 0 || f->major >= NDEV || !devsw[f->major].write))
       return -1;
-    ret = devsw[f->major].write(1, addr, n);
+    tot = 0;
+    for(i = 0; i < iovcnt; i++){
+      if(f->type == FD_PIPE)
+        r = pipewrite(f->pipe, 1, (uint64)iov[i].iov_base, iov[i].iov_len, f->nonblock);
+      else
+        r = devsw[f->major].write(1, (uint64)iov[i].iov_base, iov[i].iov_len);
+      if(r < 0)
+        return tot > 0 ? tot : r;
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    return tot;
   } else if(f->type == FD_INODE){
     // write a few blocks at a time to avoid exceeding
     // the maximum log transaction size, including
@@ -152,31 +242,146 @@ filewrite(struct file *f, uint64 addr, int n)
     // and 2 blocks of slop for non-aligned writes.
     // this really belongs lower down, since writei()
     // might be writing a device like the console.
+    // the buffers are contiguous in the file, so as many
+    // of them as fit share one transaction and one ilock.
     int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
-    int i = 0;
-    while(i < n){
-      int n1 = n - i;
-      if(n1 > max)
-        n1 = max;
-
+    i = 0;
+    done = 0;   // bytes of iov[i] already written
+    tot = 0;
+    r = n1 = 0;
+    while(i < iovcnt){
       begin_op();
       ilock(f->ip);
-      if ((r = writei(f->ip, 1, addr + i, f->off, n1)) > 0)
-        f->off += r;
+      pos = (off == -1 ? f->off : off + tot);
+      for(n = 0; i < iovcnt && n < max; n += r){
+        n1 = iov[i].iov_len - done;
+        if(n1 > max - n)
+          n1 = max - n;
+        if((r = writei(f->ip, 1, (uint64)iov[i].iov_base + done, pos + n, n1)) != n1){
+          // error from writei
+          if(r > 0)
+            n += r;
+          break;
+        }
+        done += r;
+        if(done == iov[i].iov_len){
+          i++;
+          done = 0;
+        }
+      }
+      if(off == -1)
+        f->off += n;
       iunlock(f->ip);
       end_op();
 
-      if(r != n1){
-        // error from writei
+      tot += n;
+      if(r != n1)
         break;
-      }
-      i += r;
     }
-    ret = (i == n ? n : -1);
-  } else {
-    panic("filewrite");
+    return (i == iovcnt ? tot : -1);
+  }
+  panic("filewrite");
+}
+
+// Copy up to n bytes from file in, which must be an inode, to file
+// out without passing through user space, advancing both offsets.
+// Returns the number of bytes copied, which is less than n only at
+// the end of in or on an error writing out.
+int
+filecopy(struct file *out, struct file *in, int n)
+{
+  char *buf;
+  int r, w, m, tot;
+  // see the comment in filewritev().
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+
+  if(in->readable == 0 || in->type != FD_INODE || out->writable == 0 || n < 0)
+    return -1;
+  if(out->type == FD_DEVICE &&
+     (out->major < 0 || out->major >= NDEV || !devsw[out->major].write))
+    return -1;
+  if((buf = kalloc()) == 0)
+    return -1;
+
+  // only one inode is locked at a time, and no buffer is held
+  // while writing out, so copies in opposite directions, or from
+  // a file to itself, cannot deadlock.
+  for(tot = 0; tot < n; tot += w){
+    m = n - tot;
+    if(m > max)
+      m = max;
+    ilock(in->ip);
+    if((r = readi(in->ip, 0, (uint64)buf, in->off, m)) > 0)
+      in->off += r;
+    iunlock(in->ip);
+    if(r <= 0)
+      break;
+
+    if(out->type == FD_PIPE){
+      w = pipewrite(out->pipe, 0, (uint64)buf, r, out->nonblock);
+    } else if(out->type == FD_DEVICE){
+      w = devsw[out->major].write(0, (uint64)buf, r);
+    } else {
+      begin_op();
+      ilock(out->ip);
+      if((w = writei(out->ip, 0, (uint64)buf, out->off, r)) > 0)
+        out->off += w;
+      iunlock(out->ip);
+      end_op();
+    }
+    if(w != r){
+      // leave what was not written to be copied next time,
+      // e.g. if out is a full O_NONBLOCK pipe.
+      ilock(in->ip);
+      in->off -= r - (w > 0 ? w : 0);
+      iunlock(in->ip);
+      if(w > 0)
+        tot += w;
+      else if(tot == 0)
+        tot = w == EAGAIN ? EAGAIN : -1;
+      break;
+    }
+  }
+
+  kfree(buf);
+  return tot;
+}
+
+// Read directory entries, with the attributes of the inodes they
+// name, from directory f.  addr is a user virtual address pointing
+// to an array of n struct dirstat.  Empty slots are skipped.
+// Returns the number of entries read, 0 at the end of the directory.
+int
+filegetdents(struct file *f, uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct dirent de;
+  struct dirstat ds;
+  int i;
+
+  if(f->readable == 0 || f->type != FD_INODE)
+    return -1;
+
+  ilock(f->ip);
+  if(f->ip->type != T_DIR){
+    iunlock(f->ip);
+    return -1;
+  }
+  for(i = 0; i < n && f->off + sizeof(de) <= f->ip->size; f->off += sizeof(de)){
+    if(readi(f->ip, 0, (uint64)&de, f->off, sizeof(de)) != sizeof(de))
+      break;
+    if(de.inum == 0)
+      continue;
+    direntstat(f->ip, &de, &ds);
+    if(copyout(p->pagetable, addr + i*sizeof(ds), (char*)&ds, sizeof(ds)) < 0){
+      if(i == 0)
+        i = -1;
+      break;
+    }
+    i++;
   }
+  iunlock(f->ip);
 
-  return ret;
+  return i;
 }
 
@@ -3,6 +3,7 @@ struct file {
   int ref; // reference count
   char readable;
   char writable;
+  char nonblock;     // O_NONBLOCK: return EAGAIN instead of sleeping
   struct pipe *pipe; // FD_PIPE
   struct inode *ip;  // FD_INODE and FD_DEVICE
   uint off;          // FD_INODE
@@ -29,10 +30,13 @@ struct inode {
   uint addrs[NDIRECT+1];
 };
 
+struct pollwaiter;
+
 // map major device number to device functions.
 struct devsw {
-  int (*read)(int, uint64, int);
+  int (*read)(int, uint64, int, int);
   int (*write)(int, uint64, int);
+  int (*poll)(int, struct pollwaiter*, int*);
 };
 
 extern struct devsw devsw[];
@@ -15,9 +15,11 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "sleeplock.h"
 #include "fs.h"
+#include "pcache.h"
 #include "buf.h"
 #include "file.h"
 
@@ -37,6 +39,23 @@ readsb(int dev, struct superblock *sb)
   brelse(bp);
 }
 
+// An in-memory copy of the free bit map, so that balloc() can
+// search for free blocks without reading the bitmap blocks, and
+// can find runs of them.  The bitmap blocks on disk remain the
+// record that the log keeps consistent; each change is made to
+// both, the in-memory copy while holding the bitmap block, so
+// the two agree whenever no bitmap block is locked.
+struct {
+  struct spinlock lock;
+  uchar map[FSSIZE/8 + 1];   // a set bit means the block is in use
+  uint nfree;
+  uint pending;              // blocks of files queued to be freed
+  uint next;                 // where to look when there is no goal
+} freemap;
+
+static void fmapinit(int dev);
+static void imapinit(int dev);
+
 // Init fs
 void
 fsinit(int dev) {
@@ -44,6 +63,8 @@ fsinit(int dev) {
   if(sb.magic != FSMAGIC)
     panic("invalid file system");
   initlog(dev, &sb);
+  fmapinit(dev);
+  imapinit(dev);
 }
 
 // Zero a block.
@@ -60,46 +81,151 @@ bzero(int dev, int bno)
 
 // Blocks.
 
-// Allocate a zeroed disk block.
-static uint
-balloc(uint dev)
+#define FMAPUSED(b) (freemap.map[(b)/8] & (1 << ((b)%8)))
+
+// Read the bitmap blocks into freemap.
+static void
+fmapinit(int dev)
 {
-  int b, bi, m;
   struct buf *bp;
+  uint b, n;
 
-  bp = 0;
+  if(sb.size > FSSIZE)
+    panic("fmapinit: file system too big");
+  initlock(&freemap.lock, "freemap");
   for(b = 0; b < sb.size; b += BPB){
     bp = bread(dev, BBLOCK(b, sb));
-    for(bi = 0; bi < BPB && b + bi < sb.size; bi++){
-      m = 1 << (bi % 8);
-      if((bp->data[bi/8] & m) == 0){  // Is block free?
-        bp->data[bi/8] |= m;  // Mark block in use.
-        log_write(bp);
-        brelse(bp);
-        bzero(dev, b + bi);
-        return b + bi;
-      }
-    }
+    n = min(BPB, sb.size - b);
+    memmove(freemap.map + b/8, bp->data, (n + 7) / 8);
     brelse(bp);
   }
-  panic("balloc: out of blocks");
+  freemap.nfree = 0;
+  for(b = 0; b < sb.size; b++)
+    if(!FMAPUSED(b))
+      freemap.nfree++;
+  freemap.next = sb.bmapstart + sb.size/BPB + 1;
 }
 
-// Free a disk block.
-static void
-bfree(int dev, uint b)
+// Find the first run of n free blocks at or after goal, wrapping
+// around to the start of the disk.  Whole bytes of the map in use
+// are skipped 8 blocks at a time.  Returns the first block of the
+// run, or 0 if there is none.  Caller holds freemap.lock.
+static uint
+fmapfind(uint goal, uint n)
+{
+  uint b, i, run;
+
+  if(goal >= sb.size)
+    goal = 0;
+  run = 0;
+  for(i = 0; i < sb.size + n; i++){
+    b = (goal + i) % sb.size;
+    if(b == 0)
+      run = 0;      // runs do not wrap
+    if(b % 8 == 0 && freemap.map[b/8] == 0xff && i + 8 <= sb.size + n){
+      run = 0;
+      i += 7;
+      continue;
+    }
+    if(FMAPUSED(b)){
+      run = 0;
+    } else if(++run == n){
+      return b - n + 1;
+    }
+  }
+  return 0;
+}
+
+// Allocate a zeroed disk block, at goal if that is free.
+// Otherwise, take the start of the first run of at least run
+// free blocks after goal, so that a file written sequentially,
+// or preallocated, ends up contiguous; failing that, any free
+// block.  A goal of 0 means the caller has no preference.
+static uint
+balloc(uint dev, uint goal, uint run)
 {
+  int b, bi, m;
   struct buf *bp;
-  int bi, m;
+
+  acquire(&freemap.lock);
+  b = goal;
+  if(b == 0 || b >= sb.size || FMAPUSED(b)){
+    if(goal == 0 || goal >= sb.size)
+      goal = freemap.next;
+    if(run < 1)
+      run = 1;
+    while((b = fmapfind(goal, run)) == 0 && run > 1)
+      run /= 2;
+    if(b == 0)
+      panic("balloc: out of blocks");
+  }
+  freemap.map[b/8] |= 1 << (b%8);
+  freemap.nfree--;
+  freemap.next = b + 1;
+  release(&freemap.lock);
 
   bp = bread(dev, BBLOCK(b, sb));
   bi = b % BPB;
   m = 1 << (bi % 8);
-  if((bp->data[bi/8] & m) == 0)
-    panic("freeing free block");
-  bp->data[bi/8] &= ~m;
+  if(bp->data[bi/8] & m)
+    panic("balloc: block in use");
+  bp->data[bi/8] |= m;  // Mark block in use.
   log_write(bp);
   brelse(bp);
+  bzero(dev, b);
+  return b;
+}
+
+// Free the n disk blocks listed in a[], skipping zeros.  Each
+// bitmap block involved is read and logged once, however many
+// of the blocks it covers are freed.
+static void
+bfreen(int dev, uint *a, int n)
+{
+  struct buf *bp;
+  uint lo, hi, bb, b;
+  int i, bi, m;
+
+  lo = sb.size;
+  hi = 0;
+  for(i = 0; i < n; i++){
+    if(a[i] && a[i] < lo)
+      lo = a[i];
+    if(a[i] > hi)
+      hi = a[i];
+  }
+  if(lo > hi)
+    return;
+
+  for(bb = BBLOCK(lo, sb); bb <= BBLOCK(hi, sb); bb++){
+    bp = 0;
+    for(i = 0; i < n; i++){
+      if((b = a[i]) == 0 || BBLOCK(b, sb) != bb)
+        continue;
+      if(bp == 0)
+        bp = bread(dev, bb);
+      bi = b % BPB;
+      m = 1 << (bi % 8);
+      if((bp->data[bi/8] & m) == 0)
+        panic("freeing free block");
+      bp->data[bi/8] &= ~m;
+      acquire(&freemap.lock);
+      freemap.map[b/8] &= ~(1 << (b%8));
+      freemap.nfree++;
+      release(&freemap.lock);
+    }
+    if(bp){
+      log_write(bp);
+      brelse(bp);
+    }
+  }
+}
+
+// Free a disk block.
+static void
+bfree(int dev, uint b)
+{
+  bfreen(dev, &b, 1);
 }
 
 // Inodes.
@@ -189,29 +315,82 @@ iinit()
 
 static struct inode* iget(uint dev, uint inum);
 
+// Which inodes are free, read from the inode blocks at fsinit(),
+// so that ialloc() need not read inode blocks to find one.
+// ialloc() marks an inode in use before giving it a type on disk,
+// and ifree() marks it free after clearing its type on disk.
+struct {
+  struct spinlock lock;
+  uchar map[NINODES/8 + 1];   // a set bit means the inode is in use
+  uint nfree;
+} imap;
+
+#define IMAPUSED(i) (imap.map[(i)/8] & (1 << ((i)%8)))
+
+static void
+imapinit(int dev)
+{
+  struct buf *bp;
+  struct dinode *dip;
+  uint inum;
+
+  if(sb.ninodes > NINODES)
+    panic("imapinit: too many inodes");
+  initlock(&imap.lock, "imap");
+  imap.map[0] = 1;   // there is no inode 0
+  bp = 0;
+  for(inum = 1; inum < sb.ninodes; inum++){
+    if(bp == 0 || inum % IPB == 0){
+      if(bp)
+        brelse(bp);
+      bp = bread(dev, IBLOCK(inum, sb));
+    }
+    dip = (struct dinode*)bp->data + inum%IPB;
+    if(dip->type)
+      imap.map[inum/8] |= 1 << (inum%8);
+    else
+      imap.nfree++;
+  }
+  if(bp)
+    brelse(bp);
+}
+
 // Allocate an inode on device dev.
 // Mark it as allocated by  giving it type type.
+// Take the first free inode at or after near, wrapping around,
+// so that a file's inode shares a block with its directory's
+// and with its siblings' where there is room.
 // Returns an unlocked but allocated and referenced inode.
 struct inode*
-ialloc(uint dev, short type)
+ialloc(uint dev, short type, uint near)
 {
-  int inum;
+  uint inum, i;
   struct buf *bp;
   struct dinode *dip;
 
-  for(inum = 1; inum < sb.ninodes; inum++){
-    bp = bread(dev, IBLOCK(inum, sb));
-    dip = (struct dinode*)bp->data + inum%IPB;
-    if(dip->type == 0){  // a free inode
-      memset(dip, 0, sizeof(*dip));
-      dip->type = type;
-      log_write(bp);   // mark it allocated on the disk
-      brelse(bp);
-      return iget(dev, inum);
-    }
-    brelse(bp);
+  acquire(&imap.lock);
+  if(imap.nfree == 0)
+    panic("ialloc: no inodes");
+  if(near >= sb.ninodes)
+    near = 0;
+  for(i = 0; ; i++){
+    inum = (near + i) % sb.ninodes;
+    if(!IMAPUSED(inum))
+      break;
   }
-  panic("ialloc: no inodes");
+  imap.map[inum/8] |= 1 << (inum%8);
+  imap.nfree--;
+  release(&imap.lock);
+
+  bp = bread(dev, IBLOCK(inum, sb));
+  dip = (struct dinode*)bp->data + inum%IPB;
+  if(dip->type != 0)
+    panic("ialloc: inode in use");
+  memset(dip, 0, sizeof(*dip));
+  dip->type = type;
+  log_write(bp);   // mark it allocated on the disk
+  brelse(bp);
+  return iget(dev, inum);
 }
 
 // Copy a modified in-memory inode to disk.
@@ -322,6 +501,64 @@ iunlock(struct inode *ip)
   releasesleep(&ip->lock);
 }
 
+// Truncate and free an inode that has no links left.
+// Caller holds ip->lock.
+static void
+ifree(struct inode *ip)
+{
+  itrunc(ip);
+  ip->type = 0;
+  iupdate(ip);
+  ip->valid = 0;
+
+  acquire(&imap.lock);
+  imap.map[ip->inum/8] &= ~(1 << (ip->inum%8));
+  imap.nfree++;
+  release(&imap.lock);
+}
+
+// Count n blocks as pending, to be freed by a worker, if at
+// least as many blocks are free as would then be pending.
+// Otherwise the disk is nearly full, and the caller should free
+// them itself: balloc() runs inside a transaction, so it cannot
+// wait for a worker, which needs a transaction of its own.
+static int
+fmapdefer(uint n)
+{
+  int ok;
+
+  acquire(&freemap.lock);
+  ok = freemap.nfree >= freemap.pending + n;
+  if(ok)
+    freemap.pending += n;
+  release(&freemap.lock);
+  return ok;
+}
+
+static void
+fmapundefer(uint n)
+{
+  acquire(&freemap.lock);
+  freemap.pending -= n;
+  release(&freemap.lock);
+}
+
+// Free an unlinked inode on behalf of iput(), from the work queue.
+// a1 is the number of blocks fmapdefer() counted as pending.
+static void
+ifreework(uint64 a0, uint64 a1)
+{
+  struct inode *ip = (struct inode*)a0;
+
+  begin_op();
+  acquiresleep(&ip->lock);
+  ifree(ip);
+  releasesleep(&ip->lock);
+  iput(ip);
+  end_op();
+  fmapundefer(a1);
+}
+
 // Drop a reference to an in-memory inode.
 // If that was the last reference, the inode table entry can
 // be recycled.
@@ -332,6 +569,8 @@ iunlock(struct inode *ip)
 void
 iput(struct inode *ip)
 {
+  uint n;
+
   acquire(&itable.lock);
 
   if(ip->ref == 1 && ip->valid && ip->nlink == 0){
@@ -343,10 +582,23 @@ iput(struct inode *ip)
 
     release(&itable.lock);
 
-    itrunc(ip);
-    ip->type = 0;
-    iupdate(ip);
-    ip->valid = 0;
+    // freeing a file with an indirect block can take a while;
+    // leave it to a worker, which inherits our reference, unless
+    // the disk is short of space.  no one can look the inode up
+    // again, since it has no links, and ialloc() won't reuse it
+    // until its type is cleared.
+    if(ip->size > NDIRECT*BSIZE){
+      n = (ip->size + BSIZE - 1) / BSIZE + 1;
+      if(fmapdefer(n)){
+        if(workq_add(ifreework, (uint64)ip, n) == 0){
+          releasesleep(&ip->lock);
+          return;
+        }
+        fmapundefer(n);
+      }
+    }
+
+    ifree(ip);
 
     releasesleep(&ip->lock);
 
@@ -373,28 +625,35 @@ iunlockput(struct inode *ip)
 // listed in block ip->addrs[NDIRECT].
 
 // Return the disk block address of the nth block in inode ip.
-// If there is no such block, bmap allocates one.
+// If there is no such block, bmap allocates one, just after the
+// file's previous block if that is free, or else at the start of
+// a free run of run blocks (see balloc()).
 static uint
-bmap(struct inode *ip, uint bn)
+bmap(struct inode *ip, uint bn, uint run)
 {
-  uint addr, *a;
+  uint addr, *a, goal;
   struct buf *bp;
 
   if(bn < NDIRECT){
-    if((addr = ip->addrs[bn]) == 0)
-      ip->addrs[bn] = addr = balloc(ip->dev);
+    if((addr = ip->addrs[bn]) == 0){
+      goal = (bn > 0 && ip->addrs[bn-1]) ? ip->addrs[bn-1] + 1 : 0;
+      ip->addrs[bn] = addr = balloc(ip->dev, goal, run);
+    }
     return addr;
   }
   bn -= NDIRECT;
 
   if(bn < NINDIRECT){
     // Load indirect block, allocating if necessary.
-    if((addr = ip->addrs[NDIRECT]) == 0)
-      ip->addrs[NDIRECT] = addr = balloc(ip->dev);
+    if((addr = ip->addrs[NDIRECT]) == 0){
+      goal = ip->addrs[NDIRECT-1] ? ip->addrs[NDIRECT-1] + 1 : 0;
+      ip->addrs[NDIRECT] = addr = balloc(ip->dev, goal, run + 1);
+    }
     bp = bread(ip->dev, addr);
     a = (uint*)bp->data;
     if((addr = a[bn]) == 0){
-      a[bn] = addr = balloc(ip->dev);
+      goal = (bn > 0 && a[bn-1]) ? a[bn-1] + 1 : ip->addrs[NDIRECT] + 1;
+      a[bn] = addr = balloc(ip->dev, goal, run);
       log_write(bp);
     }
     brelse(bp);
@@ -409,24 +668,20 @@ bmap(struct inode *ip, uint bn)
 void
 itrunc(struct inode *ip)
 {
-  int i, j;
+  int i;
   struct buf *bp;
   uint *a;
 
-  for(i = 0; i < NDIRECT; i++){
-    if(ip->addrs[i]){
-      bfree(ip->dev, ip->addrs[i]);
-      ip->addrs[i] = 0;
-    }
-  }
+  pcinval(ip->dev, ip->inum);
+
+  bfreen(ip->dev, ip->addrs, NDIRECT);
+  for(i = 0; i < NDIRECT; i++)
+    ip->addrs[i] = 0;
 
   if(ip->addrs[NDIRECT]){
     bp = bread(ip->dev, ip->addrs[NDIRECT]);
     a = (uint*)bp->data;
-    for(j = 0; j < NINDIRECT; j++){
-      if(a[j])
-        bfree(ip->dev, a[j]);
-    }
+    bfreen(ip->dev, a, NINDIRECT);
     brelse(bp);
     bfree(ip->dev, ip->addrs[NDIRECT]);
     ip->addrs[NDIRECT] = 0;
@@ -436,6 +691,29 @@ itrunc(struct inode *ip)
   iupdate(ip);
 }
 
+// Grow ip to size bytes, giving it zeroed blocks for the new part,
+// but allocate at most max blocks, so that callers can do it in a
+// series of transactions, calling until ip->size reaches size.
+// Each block is asked for with a run long enough for all the rest,
+// so a preallocated file is contiguous when free space allows.
+// Caller must hold ip->lock.  Returns -1 if size is too big.
+int
+iextend(struct inode *ip, uint size, int max)
+{
+  uint bn, end;
+
+  if(size > MAXFILE*BSIZE)
+    return -1;
+  if(size <= ip->size)
+    return 0;
+  end = (size + BSIZE - 1) / BSIZE;
+  for(bn = (ip->size + BSIZE - 1) / BSIZE; bn < end && max > 0; bn++, max--)
+    bmap(ip, bn, end - bn);
+  ip->size = min(bn*BSIZE, size);
+  iupdate(ip);
+  return 0;
+}
+
 // Copy stat information from inode.
 // Caller must hold ip->lock.
 void
@@ -448,6 +726,36 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+// Return page pgno of ip's contents from the page cache, reading
+// it in through the buffer cache if it was not cached, or 0 if the
+// page cache has no room.  Bytes past the end of the file are zero.
+// Caller must hold ip->lock.
+static struct cpage*
+pgread(struct inode *ip, uint pgno)
+{
+  struct cpage *pg;
+  struct buf *bp;
+  uint i, off;
+
+  if((pg = pcget(ip->dev, ip->inum, pgno)) == 0)
+    return 0;
+  if(!pg->valid){
+    for(i = 0; i < PGSIZE/BSIZE; i++){
+      off = pgno*PGSIZE + i*BSIZE;
+      if(off < ip->size){
+        bp = bread(ip->dev, bmap(ip, off/BSIZE, 1));
+        memmove(pg->data + i*BSIZE, bp->data, BSIZE);
+        // the page cache has it now.
+        brelsecold(bp);
+      } else {
+        memset(pg->data + i*BSIZE, 0, BSIZE);
+      }
+    }
+    pg->valid = 1;
+  }
+  return pg;
+}
+
 // Read data from inode.
 // Caller must hold ip->lock.
 // If user_dst==1, then dst is a user virtual address;
@@ -456,7 +764,9 @@ int
 readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 {
   uint tot, m;
+  int r;
   struct buf *bp;
+  struct cpage *pg;
 
   if(off > ip->size || off + n < off)
     return 0;
@@ -464,14 +774,20 @@ readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
     n = ip->size - off;
 
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
-    m = min(n - tot, BSIZE - off%BSIZE);
-    if(either_copyout(user_dst, dst, bp->data + (off % BSIZE), m) == -1) {
+    if((pg = pgread(ip, off/PGSIZE)) != 0){
+      m = min(n - tot, PGSIZE - off%PGSIZE);
+      r = either_copyout(user_dst, dst, pg->data + (off % PGSIZE), m);
+      pcput(pg);
+    } else {
+      bp = bread(ip->dev, bmap(ip, off/BSIZE, 1));
+      m = min(n - tot, BSIZE - off%BSIZE);
+      r = either_copyout(user_dst, dst, bp->data + (off % BSIZE), m);
       brelse(bp);
+    }
+    if(r == -1) {
       tot = -1;
       break;
     }
-    brelse(bp);
   }
   return tot;
 }
@@ -488,6 +804,7 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  struct cpage *pg;
 
   if(off > ip->size || off + n < off)
     return -1;
@@ -495,13 +812,19 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
     return -1;
 
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
+    // ask for a run as long as the rest of the write.
+    bp = bread(ip->dev, bmap(ip, off/BSIZE, (off + n - tot - 1)/BSIZE - off/BSIZE + 1));
     m = min(n - tot, BSIZE - off%BSIZE);
     if(either_copyin(bp->data + (off % BSIZE), user_src, src, m) == -1) {
       brelse(bp);
       break;
     }
     log_write(bp);
+    // keep a cached copy of the page up to date.
+    if((pg = pclookup(ip->dev, ip->inum, off/PGSIZE)) != 0){
+      memmove(pg->data + (off % PGSIZE), bp->data + (off % BSIZE), m);
+      pcput(pg);
+    }
     brelse(bp);
   }
 
@@ -552,6 +875,30 @@ dirlookup(struct inode *dp, char *name, uint *poff)
   return 0;
 }
 
+// Fill in *ds for the entry de of directory dp.
+// The attributes are copied from the on-disk inode block, so the
+// entry's inode is neither locked nor brought into the inode table;
+// locking it here could deadlock on ".." against a concurrent
+// unlink(), which locks parent before child.  As with stat(), the
+// result is only a snapshot.
+// Caller must hold dp->lock.
+void
+direntstat(struct inode *dp, struct dirent *de, struct dirstat *ds)
+{
+  struct buf *bp;
+  struct dinode *dip;
+
+  memset(ds, 0, sizeof(*ds));
+  ds->inum = de->inum;
+  memmove(ds->name, de->name, DIRSIZ);
+  bp = bread(dp->dev, IBLOCK(de->inum, sb));
+  dip = (struct dinode*)bp->data + de->inum%IPB;
+  ds->type = dip->type;
+  ds->nlink = dip->nlink;
+  ds->size = dip->size;
+  brelse(bp);
+}
+
 // Write a new directory entry (name, inum) into the directory dp.
 int
 dirlink(struct inode *dp, char *name, uint inum)
@@ -622,18 +969,22 @@ skipelem(char *path, char *name)
 }
 
 // Look up and return the inode for a path name.
+// A relative path is resolved starting at dp, or at the current
+// directory if dp is 0.
 // If parent != 0, return the inode for the parent and copy the final
 // path element into name, which must have room for DIRSIZ bytes.
 // Must be called inside a transaction since it calls iput().
 static struct inode*
-namex(char *path, int nameiparent, char *name)
+namex(struct inode *dp, char *path, int nameiparent, char *name)
 {
   struct inode *ip, *next;
 
   if(*path == '/')
     ip = iget(ROOTDEV, ROOTINO);
+  else if(dp)
+    ip = idup(dp);
   else
-    ip = idup(myproc()->cwd);
+    ip = cwdget();
 
   while((path = skipelem(path, name)) != 0){
     ilock(ip);
@@ -664,11 +1015,26 @@ struct inode*
 namei(char *path)
 {
   char name[DIRSIZ];
-  return namex(path, 0, name);
+  return namex(0, path, 0, name);
 }
 
 struct inode*
 nameiparent(char *path, char *name)
 {
-  return namex(path, 1, name);
+  return namex(0, path, 1, name);
+}
+
+// Like namei() and nameiparent(), but resolve relative paths
+// starting at directory dp (the current directory if dp is 0).
+struct inode*
+nameiat(struct inode *dp, char *path)
+{
+  char name[DIRSIZ];
+  return namex(dp, path, 0, name);
+}
+
+struct inode*
+nameiparentat(struct inode *dp, char *path, char *name)
+{
+  return namex(dp, path, 1, name);
 }
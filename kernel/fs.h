@@ -58,3 +58,13 @@ struct dirent {
   char name[DIRSIZ];
 };
 
+// A directory entry together with the attributes of the inode
+// it names, as returned by getdents().
+struct dirstat {
+  uint inum;             // Inode number
+  short type;            // Type of file
+  short nlink;           // Number of links to file
+  uint64 size;           // Size of file in bytes
+  char name[DIRSIZ+1];   // Nul-terminated name
+};
+
@@ -1,11 +1,13 @@
 #include "types.h"
 #include "riscv.h"
+#include "memlayout.h"
 #include "defs.h"
 #include "param.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "trace.h"
 
 // Simple logging that allows concurrent FS system calls.
 //
@@ -21,6 +23,16 @@
 // But if it thinks the log is close to running out, it
 // sleeps until the last outstanding end_op() commits.
 //
+// The last end_op() commits only if the log is close to
+// running out, the transaction is COMMITAGE ticks old, or
+// log_sync() asked for it. Otherwise the transaction stays
+// open, so later system calls add to it and repeated writes
+// of the same block (the bitmap, an inode block, a directory)
+// are absorbed. The flusher thread commits transactions once
+// they are old enough, so system calls seldom wait for the
+// disk; a crash loses at most the last COMMITAGE ticks of
+// updates, but never leaves the file system inconsistent.
+//
 // The log is a physical re-do log containing disk blocks.
 // The on-disk log format:
 //   header block, containing block #s for block A, B, C, ...
@@ -43,6 +55,9 @@ struct log {
   int size;
   int outstanding; // how many FS sys calls are executing.
   int committing;  // in commit(), please wait.
+  int force;       // log_sync() is waiting; commit soon.
+  uint64 since;    // time CSR when the open transaction began.
+  int ncommit;     // number of commits done.
   int dev;
   struct logheader lh;
 };
@@ -50,6 +65,7 @@ struct log log;
 
 static void recover_from_log(void);
 static void commit();
+static void flusher(void);
 
 void
 initlog(int dev, struct superblock *sb)
@@ -62,6 +78,8 @@ initlog(int dev, struct superblock *sb)
   log.size = sb->nlog;
   log.dev = dev;
   recover_from_log();
+  if(kthread("flusher", flusher, -1) < 0)
+    panic("initlog: flusher");
 }
 
 // Copy committed blocks from log to their home location
@@ -75,6 +93,7 @@ install_trans(int recovering)
     struct buf *dbuf = bread(log.dev, log.lh.block[tail]); // read dst
     memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
     bwrite(dbuf);  // write dst to disk
+    dbuf->dirty = 0;
     if(recovering == 0)
       bunpin(dbuf);
     brelse(lbuf);
@@ -141,20 +160,49 @@ begin_op(void)
   }
 }
 
+// Commit the open transaction.  Caller holds log.lock,
+// and no FS system calls are outstanding.
+static void
+docommit(void)
+{
+  log.committing = 1;
+  release(&log.lock);
+
+  // call commit w/o holding locks, since not allowed
+  // to sleep with locks.
+  commit();
+
+  acquire(&log.lock);
+  log.committing = 0;
+  log.force = 0;
+  log.ncommit++;
+  wakeup(&log);
+}
+
+// Should the open transaction be committed now?
+// Caller holds log.lock.
+static int
+mustcommit(void)
+{
+  if(log.lh.n == 0)
+    return log.force;
+  // the next op might not fit, or the transaction is old.
+  return log.force || log.lh.n + MAXOPBLOCKS > LOGSIZE ||
+    r_time() - log.since >= COMMITAGE*TICKTIME;
+}
+
 // called at the end of each FS system call.
-// commits if this was the last outstanding operation.
+// commits if this was the last outstanding operation
+// and the transaction should not stay open any longer.
 void
 end_op(void)
 {
-  int do_commit = 0;
-
   acquire(&log.lock);
   log.outstanding -= 1;
   if(log.committing)
     panic("log.committing");
-  if(log.outstanding == 0){
-    do_commit = 1;
-    log.committing = 1;
+  if(log.outstanding == 0 && mustcommit()){
+    docommit();
   } else {
     // begin_op() may be waiting for log space,
     // and decrementing log.outstanding has decreased
@@ -162,15 +210,46 @@ end_op(void)
     wakeup(&log);
   }
   release(&log.lock);
+}
 
-  if(do_commit){
-    // call commit w/o holding locks, since not allowed
-    // to sleep with locks.
-    commit();
-    acquire(&log.lock);
-    log.committing = 0;
-    wakeup(&log);
-    release(&log.lock);
+// Commit every FS system call that has finished, and wait
+// until the commit is on disk.
+void
+log_sync(void)
+{
+  int n;
+
+  begin_op();
+  acquire(&log.lock);
+  log.force = 1;
+  n = log.ncommit;
+  release(&log.lock);
+  // the last outstanding end_op(), perhaps this one, commits.
+  end_op();
+
+  acquire(&log.lock);
+  while(log.ncommit == n)
+    sleep(&log, &log.lock);
+  release(&log.lock);
+}
+
+// The flusher commits open transactions once they are
+// COMMITAGE ticks old, if no FS system call is running.
+// Otherwise the last one to finish will commit.  end_op()
+// wakes the flusher when the last running call finishes.
+static void
+flusher(void)
+{
+  acquire(&log.lock);
+  for(;;){
+    if(log.outstanding == 0 && !log.committing && mustcommit()){
+      docommit();
+      continue;
+    }
+    if(log.lh.n > 0 && log.outstanding == 0 && !log.committing)
+      sleepuntil(&log, &log.lock, log.since + COMMITAGE*TICKTIME);
+    else
+      sleep(&log, &log.lock);
   }
 }
 
@@ -194,11 +273,13 @@ static void
 commit()
 {
   if (log.lh.n > 0) {
+    TRACE(TR_COMMIT, log.lh.n, 0);
     write_log();     // Write modified blocks from cache to log
     write_head();    // Write header to disk -- the real commit
     install_trans(0); // Now install writes to home locations
     log.lh.n = 0;
     write_head();    // Erase the transaction from the log
+    TRACE(TR_COMMITTED, 0, 0);
   }
 }
 
@@ -229,8 +310,11 @@ log_write(struct buf *b)
   log.lh.block[i] = b->blockno;
   if (i == log.lh.n) {  // Add new block to log?
     bpin(b);
+    if(log.lh.n == 0)
+      log.since = r_time();
     log.lh.n++;
   }
+  b->dirty = 1;
   release(&log.lock);
 }
 
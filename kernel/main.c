@@ -25,10 +25,18 @@ main()
     plicinit();      // set up interrupt controller
     plicinithart();  // ask PLIC for device interrupts
     binit();         // buffer cache
+    pcinit();        // page cache
     iinit();         // inode table
     fileinit();      // file table
+    pollinit();      // poll() waiting
+    uringinit();     // submission rings
+    wheelinit();     // timers for sleeping processes
+    profinit();      // profiler sample rings
+    traceinit();     // trace event rings
     virtio_disk_init(); // emulated hard disk
+    workqinit();     // deferred work queues
     userinit();      // first user process
+    workqinithart(); // this CPU's worker thread
     __sync_synchronize();
     started = 1;
   } else {
@@ -39,6 +47,7 @@ main()
     kvminithart();    // turn on paging
     trapinithart();   // install kernel trap vector
     plicinithart();   // ask PLIC for device interrupts
+    workqinithart();  // this CPU's worker thread
   }
 
   scheduler();        
@@ -27,8 +27,12 @@
 
 // core local interruptor (CLINT), which contains the timer.
 #define CLINT 0x2000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid)) // software interrupt to hartid
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
+#define TIMEFREQ 10000000            // MTIME (and time CSR) counts per second in qemu
+#define TICKTIME (TIMEFREQ / 10)     // MTIME counts per clock tick
+#define PROFTIME (TIMEFREQ / 1000)   // MTIME counts per profiler sample
 
 // qemu puts platform-level interrupt controller (PLIC) here.
 #define PLIC 0x0c000000L
@@ -62,6 +66,15 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   URING (submission rings from uring_setup(), see uring.h)
+//   THREADFRAME(i) (the trapframes of threads made by clone())
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+
+// a thread shares its page table with the rest of its group,
+// so its trapframe goes below TRAPFRAME, at a place given by
+// the index of its struct proc in proc[].
+#define THREADFRAME(i) (TRAPFRAME - ((i)+1)*PGSIZE)
+
+#define URING THREADFRAME(NPROC)
@@ -8,6 +8,11 @@
 #define MAXARG       32  // max exec arguments
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
-#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define NBUF         (MAXOPBLOCKS*6)  // size of disk block cache
+#define NPCACHE      256  // pages of file data cached
+#define COMMITAGE    5  // ticks a transaction may stay open
+#define FSSIZE       10000 // size of file system in blocks
+#define NINODES      500   // inodes in the file system
 #define MAXPATH      128   // maximum file path name
+#define MAXIOV       16    // max buffers per readv/writev
+#define NWORK        64    // deferred work items queued at once
@@ -0,0 +1,220 @@
+// Page cache.
+//
+// The page cache holds file contents in 4096-byte pages, named by
+// device, inode number and page number within the file.  readi()
+// reads file data from it, so that reading a large file does not
+// push the bitmap, inode and log blocks out of the much smaller
+// buffer cache in bio.c.  writei() still writes every block through
+// the buffer cache and the log, and copies the new bytes into the
+// page if it is cached, so the page cache never holds data the log
+// does not know about.
+//
+// Interface:
+// * pcget returns a referenced page, filled (valid) or not.
+// * pclookup returns a referenced page only if it is valid.
+// * pcput drops the reference.
+// * pcinval forgets all pages of an inode, e.g. when it is truncated.
+//
+// A page's contents are protected by the lock of the inode it
+// belongs to: callers hold ip->lock.  pcache.lock protects the
+// names, reference counts and lists.
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "riscv.h"
+#include "defs.h"
+#include "fs.h"
+#include "stat.h"
+#include "pcache.h"
+
+#define NPCHASH 61
+
+struct {
+  struct spinlock lock;
+  struct cpage page[NPCACHE];
+  struct cpage *hash[NPCHASH];
+
+  // Linked list of all pages, through prev/next.
+  // head.next is most recently used, head.prev is least.
+  struct cpage head;
+
+  uint64 nhit;
+  uint64 nmiss;
+} pcache;
+
+static int
+pchash(uint dev, uint inum, uint pgno)
+{
+  return (dev * 31 + inum * 17 + pgno) % NPCHASH;
+}
+
+void
+pcinit(void)
+{
+  struct cpage *p;
+
+  initlock(&pcache.lock, "pcache");
+  pcache.head.prev = &pcache.head;
+  pcache.head.next = &pcache.head;
+  for(p = pcache.page; p < pcache.page+NPCACHE; p++){
+    p->next = pcache.head.next;
+    p->prev = &pcache.head;
+    pcache.head.next->prev = p;
+    pcache.head.next = p;
+  }
+}
+
+// Remove p from its hash chain.  Caller holds pcache.lock.
+static void
+unhash(struct cpage *p)
+{
+  struct cpage **pp;
+
+  if(p->inum == 0)
+    return;
+  for(pp = &pcache.hash[pchash(p->dev, p->inum, p->pgno)]; *pp; pp = &(*pp)->hnext){
+    if(*pp == p){
+      *pp = p->hnext;
+      break;
+    }
+  }
+  p->inum = 0;
+  p->valid = 0;
+}
+
+// Look for a cached page.  Caller holds pcache.lock.
+static struct cpage*
+find(uint dev, uint inum, uint pgno)
+{
+  struct cpage *p;
+
+  for(p = pcache.hash[pchash(dev, inum, pgno)]; p; p = p->hnext)
+    if(p->dev == dev && p->inum == inum && p->pgno == pgno)
+      return p;
+  return 0;
+}
+
+// Return page pgno of inode inum on device dev, referenced.
+// If it is not cached, recycle the least recently used page;
+// its valid flag is clear and the caller must fill it.
+// Returns 0 if no page is free, in which case the caller
+// should go to the buffer cache directly.
+struct cpage*
+pcget(uint dev, uint inum, uint pgno)
+{
+  struct cpage *p;
+
+  acquire(&pcache.lock);
+  if((p = find(dev, inum, pgno)) != 0 && p->valid){
+    pcache.nhit++;
+    p->ref++;
+    release(&pcache.lock);
+    return p;
+  }
+  pcache.nmiss++;
+  if(p == 0){
+    for(p = pcache.head.prev; p != &pcache.head; p = p->prev)
+      if(p->ref == 0)
+        break;
+    if(p == &pcache.head){
+      release(&pcache.lock);
+      return 0;
+    }
+    unhash(p);
+    p->dev = dev;
+    p->inum = inum;
+    p->pgno = pgno;
+    p->hnext = pcache.hash[pchash(dev, inum, pgno)];
+    pcache.hash[pchash(dev, inum, pgno)] = p;
+  }
+  p->ref++;
+  release(&pcache.lock);
+
+  if(p->data == 0 && (p->data = kalloc()) == 0){
+    // out of memory; forget this page.
+    acquire(&pcache.lock);
+    p->ref--;
+    unhash(p);
+    release(&pcache.lock);
+    return 0;
+  }
+  return p;
+}
+
+// Return page pgno of inode inum, referenced, if it is cached.
+struct cpage*
+pclookup(uint dev, uint inum, uint pgno)
+{
+  struct cpage *p;
+
+  acquire(&pcache.lock);
+  if((p = find(dev, inum, pgno)) != 0 && p->valid)
+    p->ref++;
+  else
+    p = 0;
+  release(&pcache.lock);
+  return p;
+}
+
+// Release a referenced page.
+// Move to the head of the most-recently-used list.
+void
+pcput(struct cpage *p)
+{
+  acquire(&pcache.lock);
+  if(p->ref < 1)
+    panic("pcput");
+  p->ref--;
+  if(p->ref == 0){
+    p->next->prev = p->prev;
+    p->prev->next = p->next;
+    p->next = pcache.head.next;
+    p->prev = &pcache.head;
+    pcache.head.next->prev = p;
+    pcache.head.next = p;
+  }
+  release(&pcache.lock);
+}
+
+// Forget every cached page of inode inum on dev.
+// Caller holds the inode's lock, so none are in use.
+void
+pcinval(uint dev, uint inum)
+{
+  struct cpage *p;
+
+  acquire(&pcache.lock);
+  for(p = pcache.page; p < pcache.page+NPCACHE; p++){
+    if(p->dev == dev && p->inum == inum){
+      if(p->ref != 0)
+        panic("pcinval");
+      unhash(p);
+      // recycle it first.
+      p->next->prev = p->prev;
+      p->prev->next = p->next;
+      p->prev = pcache.head.prev;
+      p->next = &pcache.head;
+      pcache.head.prev->next = p;
+      pcache.head.prev = p;
+    }
+  }
+  release(&pcache.lock);
+}
+
+// Fill in the page cache's counters in cs.
+void
+pcstat(struct cachestat *cs)
+{
+  struct cpage *p;
+
+  acquire(&pcache.lock);
+  cs->phit = pcache.nhit;
+  cs->pmiss = pcache.nmiss;
+  cs->npage = 0;
+  for(p = pcache.page; p < pcache.page+NPCACHE; p++)
+    if(p->valid)
+      cs->npage++;
+  release(&pcache.lock);
+}
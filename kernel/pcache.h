@@ -0,0 +1,12 @@
+// a page of file data in the page cache
+struct cpage {
+  uint dev;
+  uint inum;           // 0 if the page holds nothing
+  uint pgno;           // page number within the file
+  int ref;
+  int valid;           // has data been read in?
+  char *data;          // PGSIZE bytes from kalloc()
+  struct cpage *prev;  // LRU list
+  struct cpage *next;
+  struct cpage *hnext; // hash chain
+};
@@ -3,10 +3,13 @@
 #include "defs.h"
 #include "param.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "fcntl.h"
+#include "poll.h"
 
 #define PIPESIZE 512
 
@@ -17,6 +20,7 @@ struct pipe {
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  struct pollwaiter *pollq; // poll()s waiting for either end
 };
 
 int
@@ -34,6 +38,7 @@ pipealloc(struct file **f0, struct file **f1)
   pi->writeopen = 1;
   pi->nwrite = 0;
   pi->nread = 0;
+  pi->pollq = 0;
   initlock(&pi->lock, "pipe");
   (*f0)->type = FD_PIPE;
   (*f0)->readable = 1;
@@ -66,6 +71,7 @@ pipeclose(struct pipe *pi, int writable)
     pi->readopen = 0;
     wakeup(&pi->nwrite);
   }
+  pollwake(&pi->pollq);
   if(pi->readopen == 0 && pi->writeopen == 0){
     release(&pi->lock);
     kfree((char*)pi);
@@ -73,10 +79,13 @@ pipeclose(struct pipe *pi, int writable)
     release(&pi->lock);
 }
 
+// Write n bytes from addr to the pipe.  If user_src==1, then addr
+// is a user virtual address; otherwise, addr is a kernel address.
+// If nonblock, write only what fits, and return EAGAIN if nothing does.
 int
-pipewrite(struct pipe *pi, uint64 addr, int n)
+pipewrite(struct pipe *pi, int user_src, uint64 addr, int n, int nonblock)
 {
-  int i = 0;
+  int i = 0, m, full = 0;
   struct proc *pr = myproc();
 
   acquire(&pi->lock);
@@ -86,24 +95,39 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
       return -1;
     }
     if(pi->nwrite == pi->nread + PIPESIZE){ //DOC: pipewrite-full
+      if(nonblock){
+        full = 1;
+        break;
+      }
       wakeup(&pi->nread);
+      pollwake(&pi->pollq);
       sleep(&pi->nwrite, &pi->lock);
     } else {
-      char ch;
-      if(copyin(pr->pagetable, &ch, addr + i, 1) == -1)
+      // copy as much as fits before the end of pi->data.
+      m = PIPESIZE - (pi->nwrite - pi->nread);
+      if(m > PIPESIZE - pi->nwrite % PIPESIZE)
+        m = PIPESIZE - pi->nwrite % PIPESIZE;
+      if(m > n - i)
+        m = n - i;
+      if(either_copyin(&pi->data[pi->nwrite % PIPESIZE], user_src, addr + i, m) == -1)
         break;
-      pi->data[pi->nwrite++ % PIPESIZE] = ch;
-      i++;
+      pi->nwrite += m;
+      i += m;
     }
   }
   wakeup(&pi->nread);
+  pollwake(&pi->pollq);
   release(&pi->lock);
 
+  if(i == 0 && full)
+    return EAGAIN;
   return i;
 }
 
+// Read up to n bytes from the pipe to user address addr.
+// If nonblock, return EAGAIN rather than wait for data.
 int
-piperead(struct pipe *pi, uint64 addr, int n)
+piperead(struct pipe *pi, uint64 addr, int n, int nonblock)
 {
   int i;
   struct proc *pr = myproc();
@@ -115,6 +139,10 @@ piperead(struct pipe *pi, uint64 addr, int n)
       release(&pi->lock);
       return -1;
     }
+    if(nonblock){
+      release(&pi->lock);
+      return EAGAIN;
+    }
     sleep(&pi->nread, &pi->lock); //DOC: piperead-sleep
   }
   for(i = 0; i < n; i++){  //DOC: piperead-copy
@@ -125,6 +153,35 @@ piperead(struct pipe *pi, uint64 addr, int n)
       break;
   }
   wakeup(&pi->nwrite);  //DOC: piperead-wakeup
+  pollwake(&pi->pollq);
   release(&pi->lock);
   return i;
 }
+
+// Which of events are ready at the readable and/or writable
+// end of pi; see filepoll().
+int
+pipepoll(struct pipe *pi, int readable, int writable, int events,
+         struct pollwaiter *w, int *woken)
+{
+  int r;
+
+  r = 0;
+  acquire(&pi->lock);
+  if(readable){
+    if(pi->nread != pi->nwrite)
+      r |= POLLIN & events;
+    if(pi->writeopen == 0)
+      r |= (POLLIN & events) | POLLHUP;
+  }
+  if(writable){
+    if(pi->readopen == 0)
+      r |= POLLERR;
+    else if(pi->nwrite != pi->nread + PIPESIZE)
+      r |= POLLOUT & events;
+  }
+  if(r == 0 && w)
+    pollwait(w, &pi->pollq, &pi->lock, woken);
+  release(&pi->lock);
+  return r;
+}
@@ -0,0 +1,144 @@
+// Waiting for any of several files at once, for poll().
+//
+// A file that can become ready, a pipe or the console, keeps a
+// queue of pollwaiters, protected by the file's own lock.  poll()
+// asks each file whether it is ready; one that is not puts a
+// waiter on its queue.  When the file's state changes, it calls
+// pollwake(), which marks the waiters and wakes their processes.
+// Regular files are always ready.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "fcntl.h"
+#include "poll.h"
+#include "defs.h"
+
+struct {
+  struct spinlock lock;
+} polls;
+
+void
+pollinit(void)
+{
+  initlock(&polls.lock, "poll");
+}
+
+// Put w on queue q, which lk protects, for the poll() that
+// will sleep until *woken is set.  Caller holds lk.
+void
+pollwait(struct pollwaiter *w, struct pollwaiter **q, struct spinlock *lk, int *woken)
+{
+  w->woken = woken;
+  w->lk = lk;
+  w->q = q;
+  w->next = *q;
+  *q = w;
+}
+
+// Take w off its queue, if it is on one.
+static void
+pollcancel(struct pollwaiter *w)
+{
+  struct pollwaiter **pp;
+
+  if(w->q == 0)
+    return;
+  acquire(w->lk);
+  for(pp = w->q; *pp; pp = &(*pp)->next){
+    if(*pp == w){
+      *pp = w->next;
+      break;
+    }
+  }
+  release(w->lk);
+  w->q = 0;
+}
+
+// The file whose queue is q may have become ready.
+// Caller holds the lock protecting q.
+void
+pollwake(struct pollwaiter **q)
+{
+  struct pollwaiter *w;
+
+  if(*q == 0)
+    return;
+  acquire(&polls.lock);
+  for(w = *q; w; w = w->next)
+    *w->woken = 1;
+  wakeup(&polls);
+  release(&polls.lock);
+}
+
+// Wait until one of the nfds files described by the pollfds
+// at user address addr is ready, or timeout ticks pass;
+// a timeout of -1 means wait for ever.  Fills in each
+// revents and returns how many are non-zero.
+int
+poll(uint64 addr, int nfds, int timeout)
+{
+  struct pollfd pfd[NOFILE];
+  struct pollwaiter w[NOFILE];
+  struct file *f[NOFILE];
+  struct proc *p = myproc();
+  int i, n, woken;
+  uint64 deadline;
+
+  if(nfds < 0 || nfds > NOFILE)
+    return -1;
+  if(copyin(p->pagetable, (char*)pfd, addr, nfds * sizeof(pfd[0])) < 0)
+    return -1;
+
+  for(i = 0; i < nfds; i++)
+    f[i] = pfd[i].fd < 0 ? 0 : fdget(pfd[i].fd);
+
+  deadline = r_time() + (uint64)timeout * TICKTIME;
+  for(;;){
+    // ask each file, queueing a waiter on those not ready.
+    woken = 0;
+    n = 0;
+    for(i = 0; i < nfds; i++){
+      w[i].q = 0;
+      if(pfd[i].fd < 0)
+        pfd[i].revents = 0;   // ignored
+      else if(f[i] == 0)
+        pfd[i].revents = POLLNVAL;
+      else
+        pfd[i].revents = filepoll(f[i], pfd[i].events, timeout != 0 ? &w[i] : 0, &woken);
+      if(pfd[i].revents)
+        n++;
+    }
+
+    if(n == 0 && timeout != 0){
+      acquire(&polls.lock);
+      while(!woken && !p->killed && (timeout < 0 || r_time() < deadline)){
+        if(timeout < 0)
+          sleep(&polls, &polls.lock);
+        else
+          sleepuntil(&polls, &polls.lock, deadline);
+      }
+      release(&polls.lock);
+    }
+
+    for(i = 0; i < nfds; i++)
+      pollcancel(&w[i]);
+    if(n > 0 || timeout == 0 || p->killed)
+      break;
+    if(timeout > 0 && r_time() >= deadline)
+      break;
+  }
+
+  if(p->killed)
+    return -1;
+  if(copyout(p->pagetable, addr, (char*)pfd, nfds * sizeof(pfd[0])) < 0)
+    return -1;
+  return n;
+}
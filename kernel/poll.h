@@ -0,0 +1,7 @@
+// one poll() call waiting for one file to become ready
+struct pollwaiter {
+  int *woken;                // set by pollwake(); polls.lock protects it
+  struct spinlock *lk;       // the file's lock, which protects its queue
+  struct pollwaiter **q;     // the queue this is on
+  struct pollwaiter *next;
+};
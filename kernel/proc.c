@@ -3,7 +3,9 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
+#include "trace.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
@@ -17,6 +19,9 @@ struct spinlock pid_lock;
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static void vmlock(struct proc *g);
+static void vmunlock(struct proc *g);
+static void idle(struct cpu *c, int id);
 
 extern char trampoline[]; // trampoline.S
 
@@ -26,6 +31,12 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
+// futexwait() and futexwake() sleep and wake on the physical
+// address of a user word, so that threads sharing a page table
+// find each other.  futex_lock makes checking the word and going
+// to sleep atomic with respect to futexwake().
+struct spinlock futex_lock;
+
 // Allocate a page for each process's kernel stack.
 // Map it high in memory, followed by an invalid
 // guard page.
@@ -50,8 +61,10 @@ procinit(void)
   
   initlock(&pid_lock, "nextpid");
   initlock(&wait_lock, "wait_lock");
+  initlock(&futex_lock, "futex");
   for(p = proc; p < &proc[NPROC]; p++) {
       initlock(&p->lock, "proc");
+      initlock(&p->filelock, "files");
       p->kstack = KSTACK((int) (p - proc));
   }
 }
@@ -119,6 +132,10 @@ allocproc(void)
 found:
   p->pid = allocpid();
   p->state = USED;
+  p->bindcpu = -1;
+  p->trapva = TRAPFRAME;
+  memset(&p->ru, 0, sizeof(p->ru));
+  memset(&p->cru, 0, sizeof(p->cru));
 
   // Allocate a trapframe page.
   if((p->trapframe = (struct trapframe *)kalloc()) == 0){
@@ -156,13 +173,18 @@ freeproc(struct proc *p)
   if(p->pagetable)
     proc_freepagetable(p->pagetable, p->sz);
   p->pagetable = 0;
+  p->trapva = 0;
   p->sz = 0;
   p->pid = 0;
   p->parent = 0;
+  p->leader = 0;
+  p->nthread = 0;
+  p->vmbusy = 0;
   p->name[0] = 0;
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
+  p->kfn = 0;
   p->state = UNUSED;
 }
 
@@ -247,23 +269,193 @@ userinit(void)
   release(&p->lock);
 }
 
-// Grow or shrink user memory by n bytes.
+// A kernel thread starts here, in the scheduler's place.
+static void
+kthreadret(void)
+{
+  struct proc *p = myproc();
+
+  // Still holding p->lock from scheduler.
+  release(&p->lock);
+  p->kfn();
+  panic("kthread returned");
+}
+
+// Create a kernel thread that runs fn() in the kernel forever,
+// without a parent or user memory of its own.  If cpu is not -1,
+// the thread only ever runs on that CPU.
+int
+kthread(char *name, void (*fn)(void), int cpu)
+{
+  struct proc *p;
+  int pid;
+
+  if((p = allocproc()) == 0)
+    return -1;
+  p->kfn = fn;
+  p->bindcpu = cpu;
+  p->context.ra = (uint64)kthreadret;
+  safestrcpy(p->name, name, sizeof(p->name));
+  pid = p->pid;
+  p->state = RUNNABLE;
+  wakeidle(p);
+  release(&p->lock);
+  return pid;
+}
+
+// The group of threads p belongs to is named by its leader,
+// the process whose page table its threads share.
+static struct proc*
+group(struct proc *p)
+{
+  return p->leader ? p->leader : p;
+}
+
+// Create a kernel thread in the caller's group.  Like a thread
+// from clone(), it shares the group's page table, open files and
+// current directory, and the leader's exit kills it and waits for
+// it; but it runs fn() in the kernel, and has no trapframe.  It
+// must call exit() once killed, rather than return from fn.
+int
+kclone(char *name, void (*fn)(void))
+{
+  struct proc *np;
+  struct proc *p = myproc();
+  struct proc *g = group(p);
+  int pid;
+
+  if((np = allocproc()) == 0)
+    return -1;
+  proc_freepagetable(np->pagetable, 0);
+  np->pagetable = 0;
+  // it needs neither a page table nor a trapframe; with trapva
+  // left set, exit() would unmap TRAPFRAME from the leader's.
+  kfree((void*)np->trapframe);
+  np->trapframe = 0;
+  np->trapva = 0;
+  np->kfn = fn;
+  np->context.ra = (uint64)kthreadret;
+  safestrcpy(np->name, name, sizeof(np->name));
+  pid = np->pid;
+  release(&np->lock);
+
+  acquire(&wait_lock);
+  np->parent = p;
+  np->leader = g;
+  np->pagetable = g->pagetable;
+  np->sz = g->sz;
+  g->nthread++;
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  np->state = RUNNABLE;
+  wakeidle(np);
+  release(&np->lock);
+  return pid;
+}
+
+// Make sure that no CPU's TLB still holds a translation from
+// page table pt that the caller has removed.  userret in
+// trampoline.S flushes the TLB on every entry to user space, so
+// rather than interrupt the other CPUs, wait until each one that
+// was using pt has either entered user space again or switched
+// to another process.  The timer makes that happen within a tick.
+static void
+tlbshootdown(pagetable_t pt)
+{
+  uint64 nflush[NCPU];
+  struct cpu *c;
+
+  // this CPU is in the kernel, and flushes before it next
+  // returns to user space.
+  push_off();
+  mycpu()->upt = 0;
+  pop_off();
+
+  __sync_synchronize();
+  for(c = cpus; c < &cpus[NCPU]; c++)
+    nflush[c - cpus] = c->nflush;
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    while(c->upt == pt && c->nflush == nflush[c - cpus])
+      yield();
+  }
+}
+
+// Shrink memory shared by a thread group from oldsz to newsz.
+// Other CPUs may be running the group's threads, so unmap a
+// batch of pages, wait for every TLB to forget them, and only
+// then free them.  Returns -1 if out of memory.
+static int
+shrinkshared(pagetable_t pt, uint64 oldsz, uint64 newsz)
+{
+  uint64 *pa, a;
+  pte_t *pte;
+  int i, n;
+
+  if(PGROUNDUP(newsz) >= PGROUNDUP(oldsz))
+    return 0;
+  if((pa = (uint64*)kalloc()) == 0)
+    return -1;
+  a = PGROUNDUP(oldsz);
+  while(a > PGROUNDUP(newsz)){
+    for(n = 0; n < PGSIZE/sizeof(uint64) && a > PGROUNDUP(newsz); n++){
+      a -= PGSIZE;
+      if((pte = walk(pt, a, 0)) == 0 || (*pte & PTE_V) == 0)
+        panic("shrinkshared");
+      pa[n] = PTE2PA(*pte);
+      *pte = 0;
+    }
+    tlbshootdown(pt);
+    for(i = 0; i < n; i++)
+      kfree((void*)pa[i]);
+  }
+  kfree((void*)pa);
+  return 0;
+}
+
+// Grow or shrink user memory by n bytes, and store the old
+// size in *oldsz.  A thread changes the memory of its whole group.
 // Return 0 on success, -1 on failure.
 int
-growproc(int n)
+growproc(int n, uint64 *oldsz)
 {
-  uint sz;
+  uint64 sz;
   struct proc *p = myproc();
+  struct proc *g = group(p);
+  struct proc *pp;
 
-  sz = p->sz;
+  vmlock(g);
+  sz = *oldsz = g->sz;
   if(n > 0){
-    if((sz = uvmalloc(p->pagetable, sz, sz + n)) == 0) {
-      return -1;
+    if((sz = uvmalloc(g->pagetable, *oldsz, *oldsz + n)) == 0) {
+      // the memory of exited processes may still be queued
+      // for freeing; wait for that and try again.
+      workq_drain();
+      if((sz = uvmalloc(g->pagetable, *oldsz, *oldsz + n)) == 0){
+        vmunlock(g);
+        return -1;
+      }
     }
   } else if(n < 0){
-    sz = uvmdealloc(p->pagetable, sz, sz + n);
+    if(g->nthread == 0){
+      sz = uvmdealloc(g->pagetable, sz, sz + n);
+    } else if(sz + n < sz){
+      if(shrinkshared(g->pagetable, sz, sz + n) < 0){
+        vmunlock(g);
+        return -1;
+      }
+      sz = sz + n;
+    }
   }
-  p->sz = sz;
+
+  // each thread checks user addresses against its own sz.
+  acquire(&wait_lock);
+  g->sz = sz;
+  for(pp = proc; pp < &proc[NPROC]; pp++)
+    if(pp->leader == g)
+      pp->sz = sz;
+  release(&wait_lock);
+  vmunlock(g);
   return 0;
 }
 
@@ -275,9 +467,14 @@ fork(void)
   int i, pid;
   struct proc *np;
   struct proc *p = myproc();
+  struct proc *g = group(p);
+
+  // keep other threads from changing the memory being copied.
+  vmlock(g);
 
   // Allocate process.
   if((np = allocproc()) == 0){
+    vmunlock(g);
     return -1;
   }
 
@@ -285,6 +482,7 @@ fork(void)
   if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
     freeproc(np);
     release(&np->lock);
+    vmunlock(g);
     return -1;
   }
   np->sz = p->sz;
@@ -296,16 +494,19 @@ fork(void)
   np->trapframe->a0 = 0;
 
   // increment reference counts on open file descriptors.
+  acquire(&g->filelock);
   for(i = 0; i < NOFILE; i++)
-    if(p->ofile[i])
-      np->ofile[i] = filedup(p->ofile[i]);
-  np->cwd = idup(p->cwd);
+    if(g->ofile[i])
+      np->ofile[i] = filedup(g->ofile[i]);
+  np->cwd = idup(g->cwd);
+  release(&g->filelock);
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
   pid = np->pid;
 
   release(&np->lock);
+  vmunlock(g);
 
   acquire(&wait_lock);
   np->parent = p;
@@ -313,12 +514,237 @@ fork(void)
 
   acquire(&np->lock);
   np->state = RUNNABLE;
+  wakeidle(np);
   release(&np->lock);
 
   return pid;
 }
 
-// Pass p's abandoned children to init.
+// Create a thread: a process that shares the caller's page table,
+// open files and current directory, all of which belong to the
+// group's leader.
+// It begins at fn(arg) on the user stack whose top is stack, and
+// must call exit() rather than return from fn.
+// Returns the new thread's pid.
+int
+clone(uint64 fn, uint64 arg, uint64 stack)
+{
+  int tid;
+  struct proc *np;
+  struct proc *p = myproc();
+  struct proc *g = group(p);
+
+  if((np = allocproc()) == 0)
+    return -1;
+
+  // use the group's page table rather than a new one, with
+  // the trapframe at a place of the thread's own.
+  proc_freepagetable(np->pagetable, 0);
+  np->pagetable = 0;
+  np->trapva = THREADFRAME(np - proc);
+  release(&np->lock);
+
+  vmlock(g);
+  if(mappages(g->pagetable, np->trapva, PGSIZE,
+              (uint64)(np->trapframe), PTE_R | PTE_W) < 0){
+    vmunlock(g);
+    acquire(&np->lock);
+    freeproc(np);
+    release(&np->lock);
+    return -1;
+  }
+  np->pagetable = g->pagetable;
+  acquire(&wait_lock);
+  np->parent = p;
+  np->leader = g;
+  np->sz = g->sz;
+  g->nthread++;
+  release(&wait_lock);
+  vmunlock(g);
+
+  *(np->trapframe) = *(p->trapframe);
+  np->trapframe->epc = fn;
+  np->trapframe->sp = stack & ~0xfL;
+  np->trapframe->a0 = arg;
+  np->trapframe->ra = 0;
+
+  safestrcpy(np->name, p->name, sizeof(p->name));
+
+  tid = np->pid;
+
+  acquire(&np->lock);
+  np->state = RUNNABLE;
+  wakeidle(np);
+  release(&np->lock);
+
+  return tid;
+}
+
+// The open files and current directory of a group belong to its
+// leader, and its filelock protects them.  A process without
+// threads is the only user of its own, so fdget() need not lock.
+// With threads, another thread's close() could free the file a
+// system call is using, so fdget() takes a reference that
+// fdput() drops when the call returns.
+
+// The file open as fd in the caller's group, or 0.
+struct file*
+fdget(int fd)
+{
+  struct proc *p = myproc();
+  struct proc *g = group(p);
+  struct file *f;
+
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  if(p->leader == 0 && p->nthread == 0)
+    return p->ofile[fd];
+  if(p->nfdheld == NELEM(p->fdheld))
+    return 0;
+  acquire(&g->filelock);
+  if((f = g->ofile[fd]) != 0)
+    p->fdheld[p->nfdheld++] = filedup(f);
+  release(&g->filelock);
+  return f;
+}
+
+// Drop the references fdget() has taken for the caller.
+void
+fdput(void)
+{
+  struct proc *p = myproc();
+
+  while(p->nfdheld > 0)
+    fileclose(p->fdheld[--p->nfdheld]);
+}
+
+// Allocate a file descriptor for the given file.
+// Takes over file reference from caller on success.
+int
+fdalloc(struct file *f)
+{
+  int fd;
+  struct proc *g = group(myproc());
+
+  acquire(&g->filelock);
+  for(fd = 0; fd < NOFILE; fd++){
+    if(g->ofile[fd] == 0){
+      g->ofile[fd] = f;
+      release(&g->filelock);
+      return fd;
+    }
+  }
+  release(&g->filelock);
+  return -1;
+}
+
+// Take fd out of the caller's group and return its file, whose
+// reference passes to the caller, or 0 if fd is not open.
+struct file*
+fdremove(int fd)
+{
+  struct proc *g = group(myproc());
+  struct file *f;
+
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  acquire(&g->filelock);
+  f = g->ofile[fd];
+  g->ofile[fd] = 0;
+  release(&g->filelock);
+  return f;
+}
+
+// A new reference to the caller's current directory.
+struct inode*
+cwdget(void)
+{
+  struct proc *g = group(myproc());
+  struct inode *ip;
+
+  acquire(&g->filelock);
+  ip = idup(g->cwd);
+  release(&g->filelock);
+  return ip;
+}
+
+// Make ip, whose reference passes to the group, the caller's
+// current directory.  Returns the old one, for the caller to iput().
+struct inode*
+cwdset(struct inode *ip)
+{
+  struct proc *g = group(myproc());
+  struct inode *old;
+
+  acquire(&g->filelock);
+  old = g->cwd;
+  g->cwd = ip;
+  release(&g->filelock);
+  return old;
+}
+
+// Serialize changes to the page table and size of group g.
+static void
+vmlock(struct proc *g)
+{
+  acquire(&wait_lock);
+  while(g->vmbusy)
+    sleep(&g->vmbusy, &wait_lock);
+  g->vmbusy = 1;
+  release(&wait_lock);
+}
+
+static void
+vmunlock(struct proc *g)
+{
+  acquire(&wait_lock);
+  g->vmbusy = 0;
+  wakeup(&g->vmbusy);
+  release(&wait_lock);
+}
+
+// Free an exited thread, adding what it used to the caller's
+// own usage.  Caller must hold wait_lock and np->lock.
+static void
+reapthread(struct proc *np)
+{
+  np->leader->nthread--;
+  ruadd(&myproc()->ru, &np->ru);
+  freeproc(np);
+}
+
+// Kill group leader p's threads and wait for them all to exit,
+// since they cannot go on without p's page table.
+void
+killthreads(struct proc *p)
+{
+  struct proc *np;
+
+  acquire(&wait_lock);
+  while(p->nthread > 0){
+    for(np = proc; np < &proc[NPROC]; np++){
+      if(np->leader == p){
+        acquire(&np->lock);
+        if(np->state == ZOMBIE){
+          reapthread(np);
+        } else {
+          np->killed = 1;
+          if(np->state == SLEEPING){
+            np->state = RUNNABLE;
+            wakeidle(np);
+          }
+        }
+        release(&np->lock);
+      }
+    }
+    if(p->nthread > 0)
+      sleep(p, &wait_lock);
+  }
+  release(&wait_lock);
+}
+
+// Pass p's abandoned children to init,
+// and its abandoned threads to their group's leader.
 // Caller must hold wait_lock.
 void
 reparent(struct proc *p)
@@ -327,12 +753,24 @@ reparent(struct proc *p)
 
   for(pp = proc; pp < &proc[NPROC]; pp++){
     if(pp->parent == p){
-      pp->parent = initproc;
-      wakeup(initproc);
+      if(pp->leader){
+        // a thread stays in its group.
+        pp->parent = pp->leader;
+      } else {
+        pp->parent = initproc;
+        wakeup(initproc);
+      }
     }
   }
 }
 
+// Free an exited process's user memory, from the work queue.
+static void
+freeaddrspace(uint64 pagetable, uint64 sz)
+{
+  proc_freepagetable((pagetable_t)pagetable, sz);
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait().
@@ -340,31 +778,62 @@ void
 exit(int status)
 {
   struct proc *p = myproc();
+  pagetable_t pt;
+  uint64 sz;
 
   if(p == initproc)
     panic("init exiting");
 
-  // Close all open files.
-  for(int fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd]){
-      struct file *f = p->ofile[fd];
-      fileclose(f);
-      p->ofile[fd] = 0;
+  if(p->leader == 0){
+    killthreads(p);
+
+    // Close all open files.  A thread has none of its own.
+    for(int fd = 0; fd < NOFILE; fd++){
+      if(p->ofile[fd]){
+        struct file *f = p->ofile[fd];
+        fileclose(f);
+        p->ofile[fd] = 0;
+      }
     }
+
+    begin_op();
+    iput(p->cwd);
+    end_op();
+    p->cwd = 0;
   }
 
-  begin_op();
-  iput(p->cwd);
-  end_op();
-  p->cwd = 0;
+  if(p->leader){
+    // the rest of the group goes on using the page table.
+    if(p->trapva){
+      vmlock(p->leader);
+      uvmunmap(p->pagetable, p->trapva, 1, 0);
+      vmunlock(p->leader);
+    }
+    p->pagetable = 0;
+    p->sz = 0;
+  } else {
+    // Nothing will run in user space here again, so let this
+    // CPU's worker free the address space instead of making
+    // the parent's wait() do it.
+    pt = p->pagetable;
+    sz = p->sz;
+    uringfree(p, pt);
+    p->pagetable = 0;
+    p->sz = 0;
+    if(workq_add(freeaddrspace, (uint64)pt, sz) < 0)
+      proc_freepagetable(pt, sz);
+  }
 
   acquire(&wait_lock);
 
   // Give any children to init.
   reparent(p);
 
-  // Parent might be sleeping in wait().
+  // Parent might be sleeping in wait(), and
+  // other threads in join() or killthreads().
   wakeup(p->parent);
+  if(p->leader)
+    wakeup(p->leader);
   
   acquire(&p->lock);
 
@@ -380,6 +849,7 @@ exit(int status)
 
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
+// Threads are not waited for, but joined.
 int
 wait(uint64 addr)
 {
@@ -393,7 +863,7 @@ wait(uint64 addr)
     // Scan through table looking for exited children.
     havekids = 0;
     for(np = proc; np < &proc[NPROC]; np++){
-      if(np->parent == p){
+      if(np->parent == p && np->leader == 0){
         // make sure the child isn't still in exit() or swtch().
         acquire(&np->lock);
 
@@ -407,6 +877,8 @@ wait(uint64 addr)
             release(&wait_lock);
             return -1;
           }
+          ruadd(&p->cru, &np->ru);
+          ruadd(&p->cru, &np->cru);
           freeproc(np);
           release(&np->lock);
           release(&wait_lock);
@@ -427,6 +899,48 @@ wait(uint64 addr)
   }
 }
 
+// Wait for thread tid of the caller's group to exit, and
+// copy its exit status to addr.  Returns tid, or -1 if
+// there is no such thread.
+int
+join(int tid, uint64 addr)
+{
+  struct proc *np;
+  struct proc *p = myproc();
+  struct proc *g = group(p);
+
+  acquire(&wait_lock);
+
+  for(;;){
+    for(np = proc; np < &proc[NPROC]; np++)
+      if(np->leader == g && np != p && np->pid == tid && np->kfn == 0)
+        break;
+    if(np == &proc[NPROC] || p->killed){
+      release(&wait_lock);
+      return -1;
+    }
+
+    // make sure the thread isn't still in exit() or swtch().
+    acquire(&np->lock);
+    if(np->state == ZOMBIE){
+      if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
+                              sizeof(np->xstate)) < 0) {
+        release(&np->lock);
+        release(&wait_lock);
+        return -1;
+      }
+      reapthread(np);
+      release(&np->lock);
+      release(&wait_lock);
+      return tid;
+    }
+    release(&np->lock);
+
+    // exit() wakes the group's leader.
+    sleep(g, &wait_lock);
+  }
+}
+
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
@@ -439,28 +953,85 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int id = cpuid();
+  int found;
   
   c->proc = 0;
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
+    found = 0;
     for(p = proc; p < &proc[NPROC]; p++) {
       acquire(&p->lock);
-      if(p->state == RUNNABLE) {
+      if(p->state == RUNNABLE && (p->bindcpu < 0 || p->bindcpu == id)) {
+        found = 1;
         // Switch to chosen process.  It is the process's job
         // to release its lock and then reacquire it
         // before jumping back to us.
         p->state = RUNNING;
         c->proc = p;
+        timerarm();   // so that p can be preempted
+        TRACE(TR_SWITCHIN, 0, 0);
+        p->since = r_time();
+        hpmcharge(p, 0);
         swtch(&c->context, &p->context);
 
         // Process is done running for now.
         // It should have changed its p->state before coming back.
         c->proc = 0;
+        c->upt = 0;
       }
       release(&p->lock);
     }
+    if(!found)
+      idle(c, id);
+  }
+}
+
+// Nothing was runnable: wait in wfi for an interrupt, perhaps
+// one sent by wakeidle() on a hart that made a process runnable,
+// rather than spinning through proc[] and contending for locks.
+static void
+idle(struct cpu *c, int id)
+{
+  struct proc *p;
+
+  // with interrupts off, no handler on this hart can make a
+  // process runnable between the check and the wfi, which
+  // returns once an interrupt is pending, even though it
+  // will not be taken until the scheduler turns them on.
+  intr_off();
+
+  // wakeidle() sets RUNNABLE and then looks at c->idle;
+  // this sets c->idle and then looks for RUNNABLE, so one
+  // or other sees what the other did.
+  c->idle = 1;
+  __sync_synchronize();
+  for(p = proc; p < &proc[NPROC]; p++)
+    if(p->state == RUNNABLE && (p->bindcpu < 0 || p->bindcpu == id))
+      break;
+  if(p == &proc[NPROC])
+    asm volatile("wfi");
+  c->idle = 0;
+}
+
+// p has just been made RUNNABLE: interrupt an idle hart that
+// may run it, if there is one.
+void
+wakeidle(struct proc *p)
+{
+  int i;
+
+  __sync_synchronize();
+  for(i = 0; i < NCPU; i++){
+    if(p->bindcpu >= 0 && p->bindcpu != i)
+      continue;
+    // claim the hart, so that another waker picks another.
+    if(cpus[i].idle && __sync_lock_test_and_set(&cpus[i].idle, 0)){
+      *(volatile uint32*)CLINT_MSIP(i) = 1;
+      return;
+    }
   }
 }
 
@@ -487,6 +1058,13 @@ sched(void)
     panic("sched interruptible");
 
   intena = mycpu()->intena;
+  TRACE(TR_SWITCHOUT, p->state, 0);
+  rucharge(p, 0);
+  hpmcharge(p, 1);
+  if(p->state == RUNNABLE)
+    p->ru.nivcsw++;
+  else if(p->state == SLEEPING)
+    p->ru.nvcsw++;
   swtch(&p->context, &mycpu()->context);
   mycpu()->intena = intena;
 }
@@ -554,6 +1132,28 @@ sleep(void *chan, struct spinlock *lk)
   acquire(lk);
 }
 
+// Like sleep(), but also wake up once the time CSR reaches when.
+void
+sleepuntil(void *chan, struct spinlock *lk, uint64 when)
+{
+  struct proc *p = myproc();
+
+  // the timer wakes only this process, under p->lock, so
+  // checking t->fired under p->lock cannot miss it.
+  timer_add(&p->timer, when, chan);
+  acquire(&p->lock);
+  release(lk);
+  if(!p->timer.fired){
+    p->chan = chan;
+    p->state = SLEEPING;
+    sched();
+    p->chan = 0;
+  }
+  release(&p->lock);
+  timer_del(&p->timer);
+  acquire(lk);
+}
+
 // Wake up all processes sleeping on chan.
 // Must be called without any p->lock.
 void
@@ -566,15 +1166,81 @@ wakeup(void *chan)
       acquire(&p->lock);
       if(p->state == SLEEPING && p->chan == chan) {
         p->state = RUNNABLE;
+        wakeidle(p);
+      }
+      release(&p->lock);
+    }
+  }
+}
+
+// Return the kernel address of the user word at addr, which
+// names it to futexwait() and futexwake(), or 0 if it is not
+// a valid, aligned user address.
+static uint64
+futexkey(uint64 addr)
+{
+  uint64 pa;
+
+  if(addr % sizeof(int) != 0)
+    return 0;
+  if((pa = walkaddr(myproc()->pagetable, PGROUNDDOWN(addr))) == 0)
+    return 0;
+  return pa + (addr - PGROUNDDOWN(addr));
+}
+
+// If the user word at addr still holds val, sleep until a
+// futexwake() on it.  Returns 0 after sleeping, -1 if the word
+// had changed or is not valid, or the process was killed.
+int
+futexwait(uint64 addr, int val)
+{
+  struct proc *p = myproc();
+  uint64 key;
+
+  acquire(&futex_lock);
+  if((key = futexkey(addr)) == 0 || *(volatile int*)key != val || p->killed){
+    release(&futex_lock);
+    return -1;
+  }
+  sleep((void*)key, &futex_lock);
+  release(&futex_lock);
+  return 0;
+}
+
+// Wake up at most n processes sleeping in futexwait() on the
+// user word at addr.  Returns the number woken.
+int
+futexwake(uint64 addr, int n)
+{
+  struct proc *p;
+  uint64 key;
+  int woken;
+
+  acquire(&futex_lock);
+  if((key = futexkey(addr)) == 0){
+    release(&futex_lock);
+    return -1;
+  }
+  woken = 0;
+  for(p = proc; p < &proc[NPROC] && woken < n; p++) {
+    if(p != myproc()){
+      acquire(&p->lock);
+      if(p->state == SLEEPING && p->chan == (void*)key) {
+        p->state = RUNNABLE;
+        wakeidle(p);
+        woken++;
       }
       release(&p->lock);
     }
   }
+  release(&futex_lock);
+  return woken;
 }
 
 // Kill the process with the given pid.
 // The victim won't exit until it tries to return
 // to user space (see usertrap() in trap.c).
+// Kernel threads, which never do, cannot be killed.
 int
 kill(int pid)
 {
@@ -582,11 +1248,12 @@ kill(int pid)
 
   for(p = proc; p < &proc[NPROC]; p++){
     acquire(&p->lock);
-    if(p->pid == pid){
+    if(p->pid == pid && p->kfn == 0){
       p->killed = 1;
       if(p->state == SLEEPING){
         // Wake process from sleep().
         p->state = RUNNABLE;
+        wakeidle(p);
       }
       release(&p->lock);
       return 0;
@@ -626,6 +1293,101 @@ either_copyin(void *dst, int user_src, uint64 src, uint64 len)
   }
 }
 
+// Charge the time since p->since to p's user time, if user is
+// set, or else to its time in the kernel.  Called by p itself.
+void
+rucharge(struct proc *p, int user)
+{
+  uint64 now = r_time();
+
+  if(user)
+    p->ru.utime += now - p->since;
+  else
+    p->ru.stime += now - p->since;
+  p->since = now;
+}
+
+// Read the counters that ru.hpm accumulates.
+static void
+hpmread(uint64 *v)
+{
+  v[HPM_CYCLE] = r_cycle();
+  v[HPM_INSTRET] = r_instret();
+  v[HPM_DTLBLD] = r_hpmcounter3();
+  v[HPM_DTLBST] = r_hpmcounter4();
+  v[HPM_ITLB] = r_hpmcounter5();
+}
+
+// Add what the hardware counters have advanced since p->hpmlast
+// to p's usage, if charge is set, and start again from now.  The
+// counters belong to the CPU, and supervisor mode cannot write
+// them to save and restore a process's counts across a switch,
+// so the scheduler notes them as p starts to run (charge 0) and
+// sched() charges p as it stops.
+void
+hpmcharge(struct proc *p, int charge)
+{
+  uint64 now[NHPM];
+  int i;
+
+  hpmread(now);
+  for(i = 0; i < NHPM; i++){
+    if(charge)
+      p->ru.hpm[i] += now[i] - p->hpmlast[i];
+    p->hpmlast[i] = now[i];
+  }
+}
+
+void
+ruadd(struct rusage *to, struct rusage *from)
+{
+  int i;
+
+  to->utime += from->utime;
+  to->stime += from->stime;
+  to->nvcsw += from->nvcsw;
+  to->nivcsw += from->nivcsw;
+  to->inblock += from->inblock;
+  to->oublock += from->oublock;
+  for(i = 0; i < NHPM; i++)
+    to->hpm[i] += from->hpm[i];
+}
+
+// Copy out a struct procinfo for each of up to n processes
+// to user address addr.  Returns how many.
+int
+procinfo(uint64 addr, int n)
+{
+  struct proc *p;
+  struct procinfo pi;
+  int i;
+
+  i = 0;
+  acquire(&wait_lock);
+  for(p = proc; p < &proc[NPROC] && i < n; p++){
+    acquire(&p->lock);
+    if(p->state == UNUSED){
+      release(&p->lock);
+      continue;
+    }
+    pi.pid = p->pid;
+    pi.ppid = p->parent ? p->parent->pid : 0;
+    pi.state = p->state;
+    pi.nthread = p->nthread;
+    pi.sz = p->sz;
+    safestrcpy(pi.name, p->name, sizeof(pi.name));
+    pi.ru = p->ru;
+    release(&p->lock);
+    if(copyout(myproc()->pagetable, addr + i * sizeof(pi), (char*)&pi, sizeof(pi)) < 0){
+      release(&wait_lock);
+      return -1;
+    }
+    i++;
+  }
+  release(&wait_lock);
+  return i;
+}
+
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
 // No lock to avoid wedging a stuck machine further.
@@ -650,7 +1412,8 @@ procdump(void)
       state = states[p->state];
     else
       state = "???";
-    printf("%d %s %s", p->pid, state, p->name);
+    printf("%d %s %s user %dms sys %dms", p->pid, state, p->name,
+           (int)(p->ru.utime / (TIMEFREQ / 1000)), (int)(p->ru.stime / (TIMEFREQ / 1000)));
     printf("\n");
   }
 }
@@ -24,6 +24,9 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  pagetable_t upt;            // User page table in use, or about to be.
+  uint64 nflush;              // Number of TLB flushes entering user space.
+  int idle;                   // Waiting in idle() for something to run.
 };
 
 extern struct cpu cpus[NCPU];
@@ -80,11 +83,22 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
+// A deadline for a process in sleepuntil(), on a CPU's timer wheel.
+struct timer {
+  uint64 when;                 // time CSR value at which to wake
+  void *chan;                  // what the process sleeps on meanwhile
+  int fired;                   // the deadline has passed; p->lock protects
+  struct proc *p;
+  struct wheel *w;             // wheel it is on, or 0
+  struct timer *next;
+};
+
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
 struct proc {
   struct spinlock lock;
+  struct spinlock filelock;    // Leader: protects ofile and cwd, which threads share
 
   // p->lock must be held when using these:
   enum procstate state;        // Process state
@@ -93,16 +107,33 @@ struct proc {
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
 
-  // wait_lock must be held when using this:
+  // wait_lock must be held when using these:
   struct proc *parent;         // Parent process
+  struct proc *leader;         // If a thread, its group's leader, else 0
+  int nthread;                 // Leader: number of threads not yet joined
+  int vmbusy;                  // Leader: someone is changing the page table
 
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
   uint64 sz;                   // Size of process memory (bytes)
   pagetable_t pagetable;       // User page table
   struct trapframe *trapframe; // data page for trampoline.S
+  uint64 trapva;               // Where trapframe is in the user page table
   struct context context;      // swtch() here to run process
-  struct file *ofile[NOFILE];  // Open files
-  struct inode *cwd;           // Current directory
+  struct file *ofile[NOFILE];  // Open files; a thread uses its leader's
+  struct inode *cwd;           // Current directory; a thread uses its leader's
+  struct file *fdheld[NOFILE]; // Files fdget() holds until the system call returns
+  int nfdheld;
+  struct uring *uring;         // Rings from uring_setup(), or 0
+  uint usqhead;                // Next submission the ring's worker will take
+  uint usqend;                 // Submissions uring_enter() has passed on
+  uint ucqtail;                // Next completion the ring's worker will fill
   char name[16];               // Process name (debugging)
+  void (*kfn)(void);           // Body of a kernel thread, else 0
+  int bindcpu;                 // CPU this must run on, or -1 for any
+  struct timer timer;          // For sleepuntil()
+  uint64 since;                // When ru's utime or stime was last charged
+  uint64 hpmlast[NHPM];        // Counters when last charged to ru.hpm
+  struct rusage ru;            // Resources used, kept up to date by the process
+  struct rusage cru;           // Resources used by waited-for children
 };
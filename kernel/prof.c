@@ -0,0 +1,152 @@
+// A sampling profiler.
+//
+// While profiling is on, each CPU running a process takes a timer
+// interrupt every PROFTIME (see timerarm() in timer.c), and at
+// every timer interrupt usertrap() or kerneltrap() records the
+// interrupted pc, and the return addresses found by following
+// the frame pointers (the kernel and user programs are compiled
+// with -fno-omit-frame-pointer), in the CPU's ring of samples.
+// prof(PROF_READ) drains the rings; samples that arrive while a
+// ring is full are counted and dropped.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "prof.h"
+#include "defs.h"
+
+#define NSAMPLE 256   // samples per CPU
+
+struct profbuf {
+  struct spinlock lock;
+  struct profsample sample[NSAMPLE];
+  uint head;          // next to read
+  uint tail;          // next to write
+  int dropped;
+};
+
+struct profbuf profbuf[NCPU];
+int profiling;
+
+void
+profinit(void)
+{
+  int i;
+
+  for(i = 0; i < NCPU; i++)
+    initlock(&profbuf[i].lock, "prof");
+}
+
+// Record a sample at a timer interrupt: pc and fp are the
+// interrupted pc and frame pointer, in user space if user is set.
+// Each frame holds the return address at fp-8 and the caller's
+// fp at fp-16.  Kernel stacks are one page, so a kernel walk
+// stops at the end of the page; a user walk stops where the
+// frame pointer leads outside the process's memory.
+void
+profsample(int user, uint64 pc, uint64 fp)
+{
+  struct proc *p = myproc();
+  struct profbuf *b;
+  struct profsample s;
+  uint64 frame[2], top;
+  int i;
+
+  s.pid = p ? p->pid : 0;
+  s.cpu = cpuid();
+  s.user = user;
+  memset(s.pc, 0, sizeof(s.pc));
+  s.pc[0] = pc;
+  top = PGROUNDUP(r_sp());
+  for(i = 1; i < PROFDEPTH; i++){
+    if(fp % 8 != 0 || fp < 16)
+      break;
+    if(user){
+      if(copyin(p->pagetable, (char*)frame, fp - 16, sizeof(frame)) < 0)
+        break;
+    } else {
+      if(fp - 16 < r_sp() || fp > top)
+        break;
+      frame[0] = ((uint64*)fp)[-2];
+      frame[1] = ((uint64*)fp)[-1];
+    }
+    s.pc[i] = frame[1];
+    // frames go up the stack; anything else is not a frame.
+    if(frame[0] <= fp)
+      break;
+    fp = frame[0];
+  }
+
+  b = &profbuf[s.cpu];
+  acquire(&b->lock);
+  if(b->tail - b->head < NSAMPLE)
+    b->sample[b->tail++ % NSAMPLE] = s;
+  else
+    b->dropped++;
+  release(&b->lock);
+}
+
+// Copy out up to n of the samples in the rings to user address
+// addr.  Returns how many.
+static int
+profread(uint64 addr, int n)
+{
+  struct profsample s[8];
+  struct profbuf *b;
+  int i, k, got;
+
+  got = 0;
+  for(i = 0; i < NCPU && got < n; i++){
+    b = &profbuf[i];
+    do {
+      // take a few at a time, so as not to keep interrupts
+      // off across copyout().
+      acquire(&b->lock);
+      for(k = 0; k < NELEM(s) && got + k < n && b->head != b->tail; k++)
+        s[k] = b->sample[b->head++ % NSAMPLE];
+      release(&b->lock);
+      if(copyout(myproc()->pagetable, addr + got * sizeof(s[0]), (char*)s, k * sizeof(s[0])) < 0)
+        return -1;
+      got += k;
+    } while(k == NELEM(s));
+  }
+  return got;
+}
+
+// The prof() system call; see prof.h.
+int
+prof(int cmd, uint64 addr, int n)
+{
+  struct profbuf *b;
+  int dropped;
+
+  switch(cmd){
+  case PROF_START:
+    for(b = profbuf; b < &profbuf[NCPU]; b++){
+      acquire(&b->lock);
+      b->head = b->tail = 0;
+      b->dropped = 0;
+      release(&b->lock);
+    }
+    profiling = 1;
+    return 0;
+  case PROF_STOP:
+    profiling = 0;
+    dropped = 0;
+    for(b = profbuf; b < &profbuf[NCPU]; b++){
+      acquire(&b->lock);
+      dropped += b->dropped;
+      release(&b->lock);
+    }
+    return dropped;
+  case PROF_READ:
+    if(n < 0)
+      return -1;
+    return profread(addr, n);
+  }
+  return -1;
+}
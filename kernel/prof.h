@@ -0,0 +1,16 @@
+// The sampling profiler's interface; see prof.c.
+
+#define PROFDEPTH 6      // pcs recorded per sample
+
+// prof() commands
+#define PROF_START 1     // discard old samples and start sampling
+#define PROF_STOP  2     // stop; returns how many samples were dropped
+#define PROF_READ  3     // copy out and remove up to n samples
+
+// Where one CPU was at one timer interrupt.
+struct profsample {
+  int pid;                // 0 if the CPU was in the scheduler
+  short cpu;
+  short user;             // 1 if in user space, 0 if in the kernel
+  uint64 pc[PROFDEPTH];   // the pc, then return addresses; 0 ends them
+};
@@ -260,6 +260,21 @@ r_mcounteren()
   return x;
 }
 
+// Supervisor-mode Counter-Enable
+static inline void 
+w_scounteren(uint64 x)
+{
+  asm volatile("csrw scounteren, %0" : : "r" (x));
+}
+
+static inline uint64
+r_scounteren()
+{
+  uint64 x;
+  asm volatile("csrr %0, scounteren" : "=r" (x) );
+  return x;
+}
+
 // machine-mode cycle counter
 static inline uint64
 r_time()
@@ -269,6 +284,68 @@ r_time()
   return x;
 }
 
+// this hart's count of clock cycles
+static inline uint64
+r_cycle()
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
+// this hart's count of instructions retired
+static inline uint64
+r_instret()
+{
+  uint64 x;
+  asm volatile("csrr %0, instret" : "=r" (x) );
+  return x;
+}
+
+// hardware performance counters, counting the events that
+// machine mode chose with the mhpmevent CSRs.
+static inline uint64
+r_hpmcounter3()
+{
+  uint64 x;
+  asm volatile("csrr %0, hpmcounter3" : "=r" (x) );
+  return x;
+}
+
+static inline uint64
+r_hpmcounter4()
+{
+  uint64 x;
+  asm volatile("csrr %0, hpmcounter4" : "=r" (x) );
+  return x;
+}
+
+static inline uint64
+r_hpmcounter5()
+{
+  uint64 x;
+  asm volatile("csrr %0, hpmcounter5" : "=r" (x) );
+  return x;
+}
+
+static inline void
+w_mhpmevent3(uint64 x)
+{
+  asm volatile("csrw mhpmevent3, %0" : : "r" (x));
+}
+
+static inline void
+w_mhpmevent4(uint64 x)
+{
+  asm volatile("csrw mhpmevent4, %0" : : "r" (x));
+}
+
+static inline void
+w_mhpmevent5(uint64 x)
+{
+  asm volatile("csrw mhpmevent5, %0" : : "r" (x));
+}
+
 // enable device interrupts
 static inline void
 intr_on()
@@ -315,6 +392,16 @@ w_tp(uint64 x)
   asm volatile("mv tp, %0" : : "r" (x));
 }
 
+// read s0, the frame pointer, since the kernel is compiled
+// with -fno-omit-frame-pointer.
+static inline uint64
+r_fp()
+{
+  uint64 x;
+  asm volatile("mv %0, s0" : "=r" (x) );
+  return x;
+}
+
 static inline uint64
 r_ra()
 {
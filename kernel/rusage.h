@@ -0,0 +1,34 @@
+// Resources used by processes, for getrusage() and procinfo().
+
+#define RUSAGE_SELF     0   // the calling process, and its joined threads
+#define RUSAGE_CHILDREN 1   // its children that wait() has returned
+
+// hardware counters, counted while the process runs; start()
+// sets the events of hpmcounter3-5 to those qemu implements.
+#define HPM_CYCLE   0       // clock cycles
+#define HPM_INSTRET 1       // instructions retired
+#define HPM_DTLBLD  2       // data TLB misses on loads
+#define HPM_DTLBST  3       // data TLB misses on stores
+#define HPM_ITLB    4       // instruction TLB misses
+#define NHPM        5
+
+struct rusage {
+  uint64 utime;     // time in user space, in time CSR counts (TIMEFREQ a second)
+  uint64 stime;     // time in the kernel, likewise
+  int nvcsw;        // times it gave up the CPU to wait for something
+  int nivcsw;       // times it was preempted
+  int inblock;      // disk blocks read for it
+  int oublock;      // disk blocks written by it
+  uint64 hpm[NHPM]; // hardware counters, indexed by HPM_*
+};
+
+// One process, as procinfo() describes it.
+struct procinfo {
+  int pid;
+  int ppid;         // parent's pid, or 0
+  int state;        // enum procstate in proc.h
+  int nthread;      // threads made by clone() not yet joined
+  uint64 sz;        // bytes of user memory
+  char name[16];
+  struct rusage ru;
+};
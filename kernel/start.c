@@ -10,7 +10,7 @@ void timerinit();
 // entry.S needs one stack per CPU.
 __attribute__ ((aligned (16))) char stack0[4096 * NCPU];
 
-// a scratch area per CPU for machine-mode timer interrupts.
+// a scratch area per CPU for machine-mode timer and software interrupts.
 uint64 timer_scratch[NCPU][5];
 
 // assembly code in kernelvec.S for machine-mode timer interrupt.
@@ -43,6 +43,19 @@ start()
   w_pmpaddr0(0x3fffffffffffffull);
   w_pmpcfg0(0xf);
 
+  // let supervisor and user mode read the cycle, time and
+  // instret CSRs, for timing and for benchmarks (user/bench.c).
+  w_mcounteren(r_mcounteren() | 7);
+  w_scounteren(r_scounteren() | 7);
+
+  // count TLB misses in hpmcounter3-5, for each process's usage
+  // (see hpmcharge() in proc.c), and let supervisor mode read
+  // them.  the event numbers are the ones qemu implements.
+  w_mhpmevent3(0x10019);   // data TLB load misses
+  w_mhpmevent4(0x1001b);   // data TLB store misses
+  w_mhpmevent5(0x10021);   // instruction TLB misses
+  w_mcounteren(r_mcounteren() | (7 << 3));
+
   // ask for clock interrupts.
   timerinit();
 
@@ -57,7 +70,9 @@ start()
 // set up to receive timer interrupts in machine mode,
 // which arrive at timervec in kernelvec.S,
 // which turns them into software interrupts for
-// devintr() in trap.c.
+// devintr() in trap.c.  the kernel sets the CLINT
+// compare register for the next interrupt it wants
+// (see timer.c); this asks for just the first tick.
 void
 timerinit()
 {
@@ -65,16 +80,15 @@ timerinit()
   int id = r_mhartid();
 
   // ask the CLINT for a timer interrupt.
-  int interval = 1000000; // cycles; about 1/10th second in qemu.
-  *(uint64*)CLINT_MTIMECMP(id) = *(uint64*)CLINT_MTIME + interval;
+  *(uint64*)CLINT_MTIMECMP(id) = *(uint64*)CLINT_MTIME + TICKTIME;
 
   // prepare information in scratch[] for timervec.
   // scratch[0..2] : space for timervec to save registers.
   // scratch[3] : address of CLINT MTIMECMP register.
-  // scratch[4] : desired interval (in cycles) between timer interrupts.
+  // scratch[4] : address of CLINT MSIP register.
   uint64 *scratch = &timer_scratch[id][0];
   scratch[3] = CLINT_MTIMECMP(id);
-  scratch[4] = interval;
+  scratch[4] = CLINT_MSIP(id);
   w_mscratch((uint64)scratch);
 
   // set the machine-mode trap handler.
@@ -83,6 +97,7 @@ timerinit()
   // enable machine-mode interrupts.
   w_mstatus(r_mstatus() | MSTATUS_MIE);
 
-  // enable machine-mode timer interrupts.
-  w_mie(r_mie() | MIE_MTIE);
+  // enable machine-mode timer interrupts, and the software
+  // interrupts that other harts send to wake this one (see wakeidle()).
+  w_mie(r_mie() | MIE_MTIE | MIE_MSIE);
 }
@@ -9,3 +9,13 @@ struct stat {
   short nlink; // Number of links to file
   uint64 size; // Size of file in bytes
 };
+
+// Buffer and page cache statistics, from cachestat().
+struct cachestat {
+  uint64 bhit;   // bread()s that found the block cached
+  uint64 bmiss;  // bread()s that read the disk
+  uint64 phit;   // file pages found in the page cache
+  uint64 pmiss;  // file pages read in from the buffer cache
+  int ndirty;    // buffers not yet written home
+  int npage;     // pages holding file data
+};
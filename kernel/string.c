@@ -1,13 +1,39 @@
 #include "types.h"
 
+// The memory functions below work a 64-bit word at a time once
+// their pointers are 8-byte aligned, since they copy and clear
+// whole pages and blocks (kalloc(), uvmalloc(), readi(), writei()).
+// RISC-V traps or is slow on misaligned word accesses, so when two
+// pointers are differently aligned they fall back to bytes.
+
+#define WORDALIGNED(p) (((uint64)(p) & 7) == 0)
+
 void*
 memset(void *dst, int c, uint n)
 {
   char *cdst = (char *) dst;
-  int i;
-  for(i = 0; i < n; i++){
-    cdst[i] = c;
+  uint64 w, *wdst;
+
+  while(n > 0 && !WORDALIGNED(cdst)){
+    *cdst++ = c;
+    n--;
   }
+  if(n >= 8){
+    w = (uchar)c;
+    w |= w << 8;
+    w |= w << 16;
+    w |= w << 32;
+    wdst = (uint64*)cdst;
+    for(; n >= 64; n -= 64, wdst += 8){
+      wdst[0] = w; wdst[1] = w; wdst[2] = w; wdst[3] = w;
+      wdst[4] = w; wdst[5] = w; wdst[6] = w; wdst[7] = w;
+    }
+    for(; n >= 8; n -= 8)
+      *wdst++ = w;
+    cdst = (char*)wdst;
+  }
+  while(n-- > 0)
+    *cdst++ = c;
   return dst;
 }
 
@@ -18,6 +44,17 @@ memcmp(const void *v1, const void *v2, uint n)
 
   s1 = v1;
   s2 = v2;
+  if(((uint64)s1 & 7) == ((uint64)s2 & 7)){
+    while(n > 0 && !WORDALIGNED(s1)){
+      if(*s1 != *s2)
+        return *s1 - *s2;
+      s1++, s2++, n--;
+    }
+    // skip equal words; the bytes of the first
+    // unequal word are compared below.
+    while(n >= 8 && *(uint64*)s1 == *(uint64*)s2)
+      s1 += 8, s2 += 8, n -= 8;
+  }
   while(n-- > 0){
     if(*s1 != *s2)
       return *s1 - *s2;
@@ -32,20 +69,54 @@ memmove(void *dst, const void *src, uint n)
 {
   const char *s;
   char *d;
+  int words;
 
   if(n == 0)
     return dst;
   
   s = src;
   d = dst;
+  words = ((uint64)s & 7) == ((uint64)d & 7);
   if(s < d && s + n > d){
     s += n;
     d += n;
+    if(words){
+      while(n > 0 && !WORDALIGNED(d)){
+        *--d = *--s;
+        n--;
+      }
+      for(; n >= 32; n -= 32){
+        d -= 32, s -= 32;
+        ((uint64*)d)[3] = ((uint64*)s)[3];
+        ((uint64*)d)[2] = ((uint64*)s)[2];
+        ((uint64*)d)[1] = ((uint64*)s)[1];
+        ((uint64*)d)[0] = ((uint64*)s)[0];
+      }
+      for(; n >= 8; n -= 8){
+        d -= 8, s -= 8;
+        *(uint64*)d = *(uint64*)s;
+      }
+    }
     while(n-- > 0)
       *--d = *--s;
-  } else
+  } else {
+    if(words){
+      while(n > 0 && !WORDALIGNED(d)){
+        *d++ = *s++;
+        n--;
+      }
+      for(; n >= 32; n -= 32, d += 32, s += 32){
+        ((uint64*)d)[0] = ((uint64*)s)[0];
+        ((uint64*)d)[1] = ((uint64*)s)[1];
+        ((uint64*)d)[2] = ((uint64*)s)[2];
+        ((uint64*)d)[3] = ((uint64*)s)[3];
+      }
+      for(; n >= 8; n -= 8, d += 8, s += 8)
+        *(uint64*)d = *(uint64*)s;
+    }
     while(n-- > 0)
       *d++ = *s++;
+  }
 
   return dst;
 }
@@ -95,13 +166,24 @@ safestrcpy(char *s, const char *t, int n)
   return os;
 }
 
+// A word contains a zero byte iff this is non-zero.
+#define HASZERO(w) (((w) - 0x0101010101010101UL) & ~(w) & 0x8080808080808080UL)
+
 int
 strlen(const char *s)
 {
-  int n;
-
-  for(n = 0; s[n]; n++)
+  const char *p;
+  const uint64 *w;
+
+  for(p = s; !WORDALIGNED(p); p++)
+    if(*p == 0)
+      return p - s;
+  // an aligned word never crosses a page boundary, so reading
+  // past the terminating nul within it is safe.
+  for(w = (const uint64*)p; !HASZERO(*w); w++)
+    ;
+  for(p = (const char*)w; *p; p++)
     ;
-  return n;
+  return p - s;
 }
 
@@ -3,8 +3,11 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "syscall.h"
+#include "trace.h"
+#include "sysstat.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
@@ -104,6 +107,33 @@ extern uint64 sys_unlink(void);
 extern uint64 sys_wait(void);
 extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
+extern uint64 sys_getdents(void);
+extern uint64 sys_openat(void);
+extern uint64 sys_mkdirat(void);
+extern uint64 sys_unlinkat(void);
+extern uint64 sys_fstatat(void);
+extern uint64 sys_readv(void);
+extern uint64 sys_writev(void);
+extern uint64 sys_pread(void);
+extern uint64 sys_pwrite(void);
+extern uint64 sys_sendfile(void);
+extern uint64 sys_cachestat(void);
+extern uint64 sys_fsync(void);
+extern uint64 sys_clone(void);
+extern uint64 sys_join(void);
+extern uint64 sys_futex_wait(void);
+extern uint64 sys_futex_wake(void);
+extern uint64 sys_poll(void);
+extern uint64 sys_fcntl(void);
+extern uint64 sys_uring_setup(void);
+extern uint64 sys_uring_enter(void);
+extern uint64 sys_fallocate(void);
+extern uint64 sys_usleep(void);
+extern uint64 sys_prof(void);
+extern uint64 sys_ktrace(void);
+extern uint64 sys_getrusage(void);
+extern uint64 sys_procinfo(void);
+extern uint64 sys_sysstat(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -127,17 +157,107 @@ static uint64 (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
+[SYS_getdents] sys_getdents,
+[SYS_openat]  sys_openat,
+[SYS_mkdirat] sys_mkdirat,
+[SYS_unlinkat] sys_unlinkat,
+[SYS_fstatat] sys_fstatat,
+[SYS_readv]   sys_readv,
+[SYS_writev]  sys_writev,
+[SYS_pread]   sys_pread,
+[SYS_pwrite]  sys_pwrite,
+[SYS_sendfile] sys_sendfile,
+[SYS_cachestat] sys_cachestat,
+[SYS_fsync]   sys_fsync,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_poll]    sys_poll,
+[SYS_fcntl]   sys_fcntl,
+[SYS_uring_setup] sys_uring_setup,
+[SYS_uring_enter] sys_uring_enter,
+[SYS_fallocate] sys_fallocate,
+[SYS_usleep] sys_usleep,
+[SYS_prof] sys_prof,
+[SYS_ktrace] sys_ktrace,
+[SYS_getrusage] sys_getrusage,
+[SYS_procinfo] sys_procinfo,
+[SYS_sysstat] sys_sysstat,
 };
 
+// Each CPU counts the calls that finish on it, so that counting
+// needs no lock and shares no cache lines.  A call that sleeps may
+// finish on a different CPU than it began on, and so be timed
+// with two cycle counters; qemu keeps them in step.
+struct sysstat cpustat[NCPU][NELEM(syscalls)];
+
+static void
+sysstatadd(int num, uint64 cycles)
+{
+  struct sysstat *s;
+  int b;
+
+  for(b = 0; b < NSYSHIST-1 && (cycles >> (b+1)) != 0; b++)
+    ;
+  push_off();
+  s = &cpustat[cpuid()][num];
+  s->count++;
+  s->cycles += cycles;
+  s->hist[b]++;
+  pop_off();
+}
+
+// The sysstat() system call: reset the counts, or copy out the
+// totals over all CPUs for up to n system calls, by number, to
+// user address addr and return how many.  Counts may be a call
+// or two out if calls finish meanwhile.
+int
+sysstat(int cmd, uint64 addr, int n)
+{
+  struct sysstat s;
+  int num, c, b;
+
+  switch(cmd){
+  case SYSSTAT_RESET:
+    memset(cpustat, 0, sizeof(cpustat));
+    return 0;
+  case SYSSTAT_READ:
+    if(n < 0)
+      return -1;
+    if(n > NELEM(syscalls))
+      n = NELEM(syscalls);
+    for(num = 0; num < n; num++){
+      memset(&s, 0, sizeof(s));
+      for(c = 0; c < NCPU; c++){
+        s.count += cpustat[c][num].count;
+        s.cycles += cpustat[c][num].cycles;
+        for(b = 0; b < NSYSHIST; b++)
+          s.hist[b] += cpustat[c][num].hist[b];
+      }
+      if(copyout(myproc()->pagetable, addr + num * sizeof(s), (char*)&s, sizeof(s)) < 0)
+        return -1;
+    }
+    return n;
+  }
+  return -1;
+}
+
 void
 syscall(void)
 {
   int num;
+  uint64 t0;
   struct proc *p = myproc();
 
   num = p->trapframe->a7;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    TRACE(TR_SYSCALL, num, 0);
+    t0 = r_cycle();
     p->trapframe->a0 = syscalls[num]();
+    fdput();
+    sysstatadd(num, r_cycle() - t0);
+    TRACE(TR_SYSRET, num, p->trapframe->a0);
   } else {
     printf("%d %s: unknown sys call %d\n",
             p->pid, p->name, num);
@@ -20,3 +20,30 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
+#define SYS_getdents 22
+#define SYS_openat 23
+#define SYS_mkdirat 24
+#define SYS_unlinkat 25
+#define SYS_fstatat 26
+#define SYS_readv  27
+#define SYS_writev 28
+#define SYS_pread  29
+#define SYS_pwrite 30
+#define SYS_sendfile 31
+#define SYS_cachestat 32
+#define SYS_fsync  33
+#define SYS_clone  34
+#define SYS_join   35
+#define SYS_futex_wait 36
+#define SYS_futex_wake 37
+#define SYS_poll   38
+#define SYS_fcntl  39
+#define SYS_uring_setup 40
+#define SYS_uring_enter 41
+#define SYS_fallocate 42
+#define SYS_usleep 43
+#define SYS_prof 44
+#define SYS_ktrace 45
+#define SYS_getrusage 46
+#define SYS_procinfo 47
+#define SYS_sysstat 48
@@ -10,11 +10,13 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "uring.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -26,7 +28,7 @@ argfd(int n, int *pfd, struct file **pf)
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if((f=fdget(fd)) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -35,21 +37,27 @@ argfd(int n, int *pfd, struct file **pf)
   return 0;
 }
 
-// Allocate a file descriptor for the given file.
-// Takes over file reference from caller on success.
+// Fetch the nth word-sized system call argument as the directory
+// file descriptor of an *at() call and return its inode, or 0 for
+// AT_FDCWD, meaning relative paths start at the current directory.
+// Whether the inode really is a directory is checked when a path
+// is resolved against it.
 static int
-fdalloc(struct file *f)
+argdirfd(int n, struct inode **pdp)
 {
   int fd;
-  struct proc *p = myproc();
+  struct file *f;
 
-  for(fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd] == 0){
-      p->ofile[fd] = f;
-      return fd;
-    }
+  if(argint(n, &fd) < 0)
+    return -1;
+  if(fd == AT_FDCWD){
+    *pdp = 0;
+    return 0;
   }
-  return -1;
+  if(argfd(n, 0, &f) < 0 || f->type != FD_INODE)
+    return -1;
+  *pdp = f->ip;
+  return 0;
 }
 
 uint64
@@ -91,15 +99,217 @@ sys_write(void)
   return filewrite(f, p, n);
 }
 
+// Fetch the iovec array pointed to by the nth system call argument,
+// with count in the next one, into iov.  Returns the count.
+static int
+argiov(int n, struct iovec *iov)
+{
+  uint64 addr;
+  uint64 tot;
+  int i, cnt;
+
+  if(argaddr(n, &addr) < 0 || argint(n+1, &cnt) < 0)
+    return -1;
+  if(cnt < 0 || cnt > MAXIOV)
+    return -1;
+  if(copyin(myproc()->pagetable, (char*)iov, addr, cnt*sizeof(*iov)) < 0)
+    return -1;
+  // the total is returned as an int.
+  tot = 0;
+  for(i = 0; i < cnt; i++){
+    if(iov[i].iov_len > 0x7fffffff || (tot += iov[i].iov_len) > 0x7fffffff)
+      return -1;
+  }
+  return cnt;
+}
+
+uint64
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[MAXIOV];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || (cnt = argiov(1, iov)) < 0)
+    return -1;
+  return filereadv(f, iov, cnt, -1);
+}
+
+uint64
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[MAXIOV];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || (cnt = argiov(1, iov)) < 0)
+    return -1;
+  return filewritev(f, iov, cnt, -1);
+}
+
+// Read at an explicit offset, leaving the file offset alone,
+// so that processes sharing a file need not serialize on it.
+uint64
+sys_pread(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+  uint64 p;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0 || argint(3, &off) < 0)
+    return -1;
+  if(n < 0 || off < 0)
+    return -1;
+  iov.iov_base = (void*)p;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, off);
+}
+
+uint64
+sys_pwrite(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+  uint64 p;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0 || argint(3, &off) < 0)
+    return -1;
+  if(n < 0 || off < 0)
+    return -1;
+  iov.iov_base = (void*)p;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, off);
+}
+
+// Copy up to n bytes from file descriptor in to file descriptor
+// out inside the kernel.
+uint64
+sys_sendfile(void)
+{
+  struct file *out, *in;
+  int n;
+
+  if(argfd(0, 0, &out) < 0 || argfd(1, 0, &in) < 0 || argint(2, &n) < 0)
+    return -1;
+  return filecopy(out, in, n);
+}
+
+// Copy the buffer and page cache statistics to user space.
+uint64
+sys_cachestat(void)
+{
+  struct cachestat cs;
+  uint64 addr; // user pointer to struct cachestat
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  bstat(&cs);
+  pcstat(&cs);
+  if(copyout(myproc()->pagetable, addr, (char*)&cs, sizeof(cs)) < 0)
+    return -1;
+  return 0;
+}
+
+// Get fd's O_ flags, or set the ones that can change:
+// only O_NONBLOCK.  The flags belong to the open file,
+// so they are shared with dup()s of fd.
+uint64
+sys_fcntl(void)
+{
+  struct file *f;
+  int cmd, arg, flags;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &cmd) < 0 || argint(2, &arg) < 0)
+    return -1;
+  switch(cmd){
+  case F_GETFL:
+    if(f->readable && f->writable)
+      flags = O_RDWR;
+    else if(f->writable)
+      flags = O_WRONLY;
+    else
+      flags = O_RDONLY;
+    if(f->nonblock)
+      flags |= O_NONBLOCK;
+    return flags;
+  case F_SETFL:
+    f->nonblock = (arg & O_NONBLOCK) != 0;
+    return 0;
+  }
+  return -1;
+}
+
+// Give fd's file blocks for its first off+len bytes, growing
+// it if it is shorter; the new bytes read as zeros.
+uint64
+sys_fallocate(void)
+{
+  struct file *f;
+  int off, len, r, done;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &off) < 0 || argint(2, &len) < 0)
+    return -1;
+  if(f->type != FD_INODE || f->writable == 0 || off < 0 || len <= 0 || off + len < off)
+    return -1;
+  // each block allocated logs itself, and there may also be
+  // two bitmap blocks, the indirect block, and the inode.
+  do {
+    begin_op();
+    ilock(f->ip);
+    r = iextend(f->ip, off + len, MAXOPBLOCKS-4);
+    done = f->ip->size >= off + len;
+    iunlock(f->ip);
+    end_op();
+  } while(r == 0 && !done);
+  return r;
+}
+
+// Wait until everything written so far, to fd's file
+// and to all others, is on disk.
+uint64
+sys_fsync(void)
+{
+  struct file *f;
+
+  if(argfd(0, 0, &f) < 0 || f->type != FD_INODE)
+    return -1;
+  log_sync();
+  return 0;
+}
+
+uint64
+sys_poll(void)
+{
+  uint64 fds;
+  int nfds, timeout;
+
+  if(argaddr(0, &fds) < 0 || argint(1, &nfds) < 0 || argint(2, &timeout) < 0)
+    return -1;
+  return poll(fds, nfds, timeout);
+}
+
+uint64
+sys_getdents(void)
+{
+  struct file *f;
+  int n;
+  uint64 p;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0)
+    return -1;
+  return filegetdents(f, p, n);
+}
+
 uint64
 sys_close(void)
 {
   int fd;
   struct file *f;
 
-  if(argfd(0, &fd, &f) < 0)
+  if(argint(0, &fd) < 0 || (f = fdremove(fd)) == 0)
     return -1;
-  myproc()->ofile[fd] = 0;
   fileclose(f);
   return 0;
 }
@@ -181,19 +391,18 @@ isdirempty(struct inode *dp)
   return 1;
 }
 
-uint64
-sys_unlink(void)
+// Remove the directory entry path, resolved relative to at
+// (or the current directory if at is 0).
+static int
+unlinkat(struct inode *at, char *path)
 {
   struct inode *ip, *dp;
   struct dirent de;
-  char name[DIRSIZ], path[MAXPATH];
+  char name[DIRSIZ];
   uint off;
 
-  if(argstr(0, path, MAXPATH) < 0)
-    return -1;
-
   begin_op();
-  if((dp = nameiparent(path, name)) == 0){
+  if((dp = nameiparentat(at, path, name)) == 0){
     end_op();
     return -1;
   }
@@ -238,13 +447,36 @@ bad:
   return -1;
 }
 
+uint64
+sys_unlink(void)
+{
+  char path[MAXPATH];
+
+  if(argstr(0, path, MAXPATH) < 0)
+    return -1;
+  return unlinkat(0, path);
+}
+
+uint64
+sys_unlinkat(void)
+{
+  char path[MAXPATH];
+  struct inode *at;
+
+  if(argdirfd(0, &at) < 0 || argstr(1, path, MAXPATH) < 0)
+    return -1;
+  return unlinkat(at, path);
+}
+
+// Create path, resolved relative to at (or the current
+// directory if at is 0).
 static struct inode*
-create(char *path, short type, short major, short minor)
+create(struct inode *at, char *path, short type, short major, short minor)
 {
   struct inode *ip, *dp;
   char name[DIRSIZ];
 
-  if((dp = nameiparent(path, name)) == 0)
+  if((dp = nameiparentat(at, path, name)) == 0)
     return 0;
 
   ilock(dp);
@@ -258,7 +490,7 @@ create(char *path, short type, short major, short minor)
     return 0;
   }
 
-  if((ip = ialloc(dp->dev, type)) == 0)
+  if((ip = ialloc(dp->dev, type, dp->inum)) == 0)
     panic("create: ialloc");
 
   ilock(ip);
@@ -283,28 +515,25 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-uint64
-sys_open(void)
+// Open path, resolved relative to at (or the current directory
+// if at is 0), and return a new file descriptor.
+static int
+openat(struct inode *at, char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  if((n = argstr(0, path, MAXPATH)) < 0 || argint(1, &omode) < 0)
-    return -1;
 
   begin_op();
 
   if(omode & O_CREATE){
-    ip = create(path, T_FILE, 0, 0);
+    ip = create(at, path, T_FILE, 0, 0);
     if(ip == 0){
       end_op();
       return -1;
     }
   } else {
-    if((ip = namei(path)) == 0){
+    if((ip = nameiat(at, path)) == 0){
       end_op();
       return -1;
     }
@@ -340,6 +569,7 @@ sys_open(void)
   f->ip = ip;
   f->readable = !(omode & O_WRONLY);
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->nonblock = (omode & O_NONBLOCK) != 0;
 
   if((omode & O_TRUNC) && ip->type == T_FILE){
     itrunc(ip);
@@ -351,6 +581,84 @@ sys_open(void)
   return fd;
 }
 
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return openat(0, path, omode);
+}
+
+uint64
+sys_openat(void)
+{
+  char path[MAXPATH];
+  int omode;
+  struct inode *at;
+
+  if(argdirfd(0, &at) < 0 || argstr(1, path, MAXPATH) < 0 || argint(2, &omode) < 0)
+    return -1;
+  return openat(at, path, omode);
+}
+
+// Carry out one operation from a process's rings (see uring.c),
+// as the system call it stands for would.
+int
+uringop(struct usqe *e)
+{
+  struct proc *p = myproc();
+  struct file *f;
+  struct iovec iov;
+  char path[MAXPATH];
+
+  if(e->op == UOP_NOP)
+    return 0;
+  if(e->op == UOP_OPEN){
+    if(copyinstr(p->pagetable, path, e->addr, MAXPATH) < 0)
+      return -1;
+    return openat(0, path, e->flags);
+  }
+
+  if((f = fdget(e->fd)) == 0)
+    return -1;
+  switch(e->op){
+  case UOP_READ:
+  case UOP_WRITE:
+    if(e->len < 0 || e->off < -1)
+      return -1;
+    iov.iov_base = (void*)e->addr;
+    iov.iov_len = e->len;
+    if(e->op == UOP_READ)
+      return filereadv(f, &iov, 1, e->off);
+    return filewritev(f, &iov, 1, e->off);
+  case UOP_CLOSE:
+    if((f = fdremove(e->fd)) == 0)
+      return -1;
+    fileclose(f);
+    return 0;
+  }
+  return -1;
+}
+
+uint64
+sys_uring_setup(void)
+{
+  return uringsetup();
+}
+
+uint64
+sys_uring_enter(void)
+{
+  int n, min;
+
+  if(argint(0, &n) < 0 || argint(1, &min) < 0)
+    return -1;
+  return uringenter(n, min);
+}
+
 uint64
 sys_mkdir(void)
 {
@@ -358,7 +666,7 @@ sys_mkdir(void)
   struct inode *ip;
 
   begin_op();
-  if(argstr(0, path, MAXPATH) < 0 || (ip = create(path, T_DIR, 0, 0)) == 0){
+  if(argstr(0, path, MAXPATH) < 0 || (ip = create(0, path, T_DIR, 0, 0)) == 0){
     end_op();
     return -1;
   }
@@ -367,6 +675,50 @@ sys_mkdir(void)
   return 0;
 }
 
+uint64
+sys_mkdirat(void)
+{
+  char path[MAXPATH];
+  struct inode *at, *ip;
+
+  if(argdirfd(0, &at) < 0 || argstr(1, path, MAXPATH) < 0)
+    return -1;
+  begin_op();
+  if((ip = create(at, path, T_DIR, 0, 0)) == 0){
+    end_op();
+    return -1;
+  }
+  iunlockput(ip);
+  end_op();
+  return 0;
+}
+
+// Get metadata about path, resolved relative to a directory fd,
+// without opening it.
+uint64
+sys_fstatat(void)
+{
+  char path[MAXPATH];
+  struct inode *at, *ip;
+  struct stat st;
+  uint64 addr; // user pointer to struct stat
+
+  if(argdirfd(0, &at) < 0 || argstr(1, path, MAXPATH) < 0 || argaddr(2, &addr) < 0)
+    return -1;
+  begin_op();
+  if((ip = nameiat(at, path)) == 0){
+    end_op();
+    return -1;
+  }
+  ilock(ip);
+  stati(ip, &st);
+  iunlockput(ip);
+  end_op();
+  if(copyout(myproc()->pagetable, addr, (char*)&st, sizeof(st)) < 0)
+    return -1;
+  return 0;
+}
+
 uint64
 sys_mknod(void)
 {
@@ -378,7 +730,7 @@ sys_mknod(void)
   if((argstr(0, path, MAXPATH)) < 0 ||
      argint(1, &major) < 0 ||
      argint(2, &minor) < 0 ||
-     (ip = create(path, T_DEVICE, major, minor)) == 0){
+     (ip = create(0, path, T_DEVICE, major, minor)) == 0){
     end_op();
     return -1;
   }
@@ -392,7 +744,6 @@ sys_chdir(void)
 {
   char path[MAXPATH];
   struct inode *ip;
-  struct proc *p = myproc();
   
   begin_op();
   if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
@@ -406,9 +757,8 @@ sys_chdir(void)
     return -1;
   }
   iunlock(ip);
-  iput(p->cwd);
+  iput(cwdset(ip));
   end_op();
-  p->cwd = ip;
   return 0;
 }
 
@@ -469,15 +819,15 @@ sys_pipe(void)
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
     if(fd0 >= 0)
-      p->ofile[fd0] = 0;
+      fdremove(fd0);
     fileclose(rf);
     fileclose(wf);
     return -1;
   }
   if(copyout(p->pagetable, fdarray, (char*)&fd0, sizeof(fd0)) < 0 ||
      copyout(p->pagetable, fdarray+sizeof(fd0), (char *)&fd1, sizeof(fd1)) < 0){
-    p->ofile[fd0] = 0;
-    p->ofile[fd1] = 0;
+    fdremove(fd0);
+    fdremove(fd1);
     fileclose(rf);
     fileclose(wf);
     return -1;
@@ -5,6 +5,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 
 uint64
@@ -41,38 +42,104 @@ sys_wait(void)
 uint64
 sys_sbrk(void)
 {
-  int addr;
+  uint64 addr;
   int n;
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  if(growproc(n, &addr) < 0)
     return -1;
   return addr;
 }
 
 uint64
-sys_sleep(void)
+sys_clone(void)
+{
+  uint64 fn, arg, stack;
+
+  if(argaddr(0, &fn) < 0 || argaddr(1, &arg) < 0 || argaddr(2, &stack) < 0)
+    return -1;
+  return clone(fn, arg, stack);
+}
+
+uint64
+sys_join(void)
+{
+  int tid;
+  uint64 p;
+
+  if(argint(0, &tid) < 0 || argaddr(1, &p) < 0)
+    return -1;
+  return join(tid, p);
+}
+
+uint64
+sys_futex_wait(void)
+{
+  uint64 addr;
+  int val;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait(addr, val);
+}
+
+uint64
+sys_futex_wake(void)
 {
+  uint64 addr;
   int n;
-  uint ticks0;
 
-  if(argint(0, &n) < 0)
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
     return -1;
+  return futexwake(addr, n);
+}
+
+// Sleep until the time CSR reaches when, on this
+// process's timer rather than waking at every tick.
+static int
+sleepto(uint64 when)
+{
+  struct proc *p = myproc();
+
   acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
+  while(r_time() < when){
+    if(p->killed){
       release(&tickslock);
       return -1;
     }
-    sleep(&ticks, &tickslock);
+    sleepuntil(&p->timer, &tickslock, when);
   }
   release(&tickslock);
   return 0;
 }
 
+// sleep until the n'th tick from now.
+uint64
+sys_sleep(void)
+{
+  int n;
+
+  if(argint(0, &n) < 0)
+    return -1;
+  if(n < 0)
+    n = 0;
+  return sleepto((r_time() / TICKTIME + n) * TICKTIME);
+}
+
+// sleep for n microseconds, which may be less than a tick.
+uint64
+sys_usleep(void)
+{
+  int n;
+
+  if(argint(0, &n) < 0)
+    return -1;
+  if(n < 0)
+    n = 0;
+  return sleepto(r_time() + (uint64)n * (TIMEFREQ / 1000000));
+}
+
 uint64
 sys_kill(void)
 {
@@ -83,15 +150,81 @@ sys_kill(void)
   return kill(pid);
 }
 
-// return how many clock tick interrupts have occurred
-// since start.
+// return how many clock ticks have passed since start.
 uint64
 sys_uptime(void)
 {
-  uint xticks;
+  return r_time() / TICKTIME;
+}
+
+// start, stop, or read the profiler; see prof.h.
+uint64
+sys_prof(void)
+{
+  int cmd, n;
+  uint64 addr;
 
-  acquire(&tickslock);
-  xticks = ticks;
-  release(&tickslock);
-  return xticks;
+  if(argint(0, &cmd) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return prof(cmd, addr, n);
+}
+
+// start, stop, or read the kernel's trace; see trace.h.
+uint64
+sys_ktrace(void)
+{
+  int cmd, n;
+  uint64 addr;
+
+  if(argint(0, &cmd) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return ktrace(cmd, addr, n);
+}
+
+// copy out the resources used by the caller, or by its
+// waited-for children; see rusage.h.
+uint64
+sys_getrusage(void)
+{
+  int who;
+  uint64 addr;
+  struct proc *p = myproc();
+  struct rusage *ru;
+
+  if(argint(0, &who) < 0 || argaddr(1, &addr) < 0)
+    return -1;
+  if(who == RUSAGE_SELF)
+    ru = &p->ru;
+  else if(who == RUSAGE_CHILDREN)
+    ru = &p->cru;
+  else
+    return -1;
+  // bring the time spent in this call up to date.
+  rucharge(p, 0);
+  hpmcharge(p, 1);
+  return copyout(p->pagetable, addr, (char*)ru, sizeof(*ru));
+}
+
+// describe up to n processes; returns how many.
+uint64
+sys_procinfo(void)
+{
+  int n;
+  uint64 addr;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return procinfo(addr, n);
+}
+
+// reset or read the system call statistics; see sysstat.h.
+uint64
+sys_sysstat(void)
+{
+  int cmd, n;
+  uint64 addr;
+
+  if(argint(0, &cmd) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return sysstat(cmd, addr, n);
 }
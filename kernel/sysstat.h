@@ -0,0 +1,17 @@
+// Counts and latencies of system calls, for sysstat().
+
+#define NSYSHIST 32      // latency buckets
+
+// sysstat() commands
+#define SYSSTAT_RESET 1  // zero the counts
+#define SYSSTAT_READ  2  // copy out up to n struct sysstats
+
+// One system call's statistics, indexed by its number.
+// hist[i] counts the calls that took at least 2^i clock
+// cycles but fewer than 2^(i+1); the last bucket also
+// counts anything longer.
+struct sysstat {
+  uint64 count;
+  uint64 cycles;             // total
+  uint hist[NSYSHIST];
+};
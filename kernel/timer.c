@@ -0,0 +1,192 @@
+// Per-CPU timer wheels, for processes sleeping until a time.
+//
+// A process that sleeps with a deadline (sleepuntil() in proc.c)
+// puts its timer on the wheel of the CPU it is running on.  Each
+// CPU sets its CLINT compare register for the earliest deadline on
+// its wheel, or for the next tick if it is running a process that
+// may need preempting, whichever is sooner.  An idle CPU with no
+// deadlines takes no timer interrupts at all, and a sleeping
+// process is woken once, at its deadline, rather than at every
+// tick to look at the clock.
+//
+// Times are values of the time CSR, which counts TIMEFREQ times
+// a second (see memlayout.h).
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "defs.h"
+
+#define NSLOT    64               // slots per wheel
+#define SLOTTIME (TICKTIME / 16)  // time each slot covers
+
+struct wheel {
+  struct spinlock lock;
+  struct timer *slot[NSLOT];  // timers due in slot-sized intervals, mod NSLOT
+  uint64 clock;               // time of the last expire()
+  uint64 next;                // earliest deadline on the wheel, or ~0
+  uint64 armed;               // what the compare register holds
+};
+
+struct wheel wheel[NCPU];
+
+void
+wheelinit(void)
+{
+  int i;
+
+  for(i = 0; i < NCPU; i++){
+    initlock(&wheel[i].lock, "wheel");
+    wheel[i].next = ~0ULL;
+    wheel[i].armed = ~0ULL;
+  }
+}
+
+// Set this CPU's timer for the earliest deadline on its wheel
+// or, if it is running a process, the next tick, or sooner if
+// the profiler wants a sample.  Interrupts must be off.
+void
+timerarm(void)
+{
+  int id = cpuid();
+  struct wheel *w = &wheel[id];
+  uint64 when, tick;
+
+  when = w->next;
+  if(mycpu()->proc){
+    tick = (r_time() / TICKTIME + 1) * TICKTIME;
+    if(profiling && r_time() + PROFTIME < tick)
+      tick = r_time() + PROFTIME;
+    if(tick < when)
+      when = tick;
+  }
+  if(when != w->armed){
+    w->armed = when;
+    *(volatile uint64*)CLINT_MTIMECMP(id) = when;
+  }
+}
+
+// Queue t to wake the current process, sleeping on chan,
+// once the time reaches when.
+void
+timer_add(struct timer *t, uint64 when, void *chan)
+{
+  struct wheel *w;
+  struct timer **tp;
+
+  push_off();
+  w = &wheel[cpuid()];
+  acquire(&w->lock);
+  t->when = when;
+  t->chan = chan;
+  t->fired = 0;
+  t->p = myproc();
+  t->w = w;
+  tp = &w->slot[(when / SLOTTIME) % NSLOT];
+  t->next = *tp;
+  *tp = t;
+  if(when < w->next){
+    w->next = when;
+    timerarm();
+  }
+  release(&w->lock);
+  pop_off();
+}
+
+// Take t off its wheel, if it has not fired.
+void
+timer_del(struct timer *t)
+{
+  struct wheel *w;
+  struct timer **tp;
+
+  if((w = t->w) == 0)
+    return;
+  acquire(&w->lock);
+  if(t->w == w){
+    for(tp = &w->slot[(t->when / SLOTTIME) % NSLOT]; *tp; tp = &(*tp)->next){
+      if(*tp == t){
+        *tp = t->next;
+        break;
+      }
+    }
+    t->w = 0;
+    // w->next may now be early; that costs at most one
+    // spurious interrupt.
+  }
+  release(&w->lock);
+}
+
+// t's deadline has passed: wake its process, if it is still
+// asleep in sleepuntil().  Caller holds t's wheel's lock.
+static void
+fire(struct timer *t)
+{
+  struct proc *p = t->p;
+
+  t->w = 0;
+  acquire(&p->lock);
+  t->fired = 1;
+  if(p->state == SLEEPING && p->chan == t->chan){
+    p->state = RUNNABLE;
+    wakeidle(p);
+  }
+  release(&p->lock);
+}
+
+// Fire the timers on w that are due by now: those in the slots
+// passed over since the last call, or since the earliest deadline
+// if that is before it, but at most one turn's worth.
+// Caller holds w->lock.
+static void
+expire(struct wheel *w, uint64 now)
+{
+  struct timer **tp, *t;
+  uint64 s;
+  int i;
+
+  s = (w->next < w->clock ? w->next : w->clock) / SLOTTIME;
+  for(i = 0; i < NSLOT && s <= now / SLOTTIME; i++, s++){
+    tp = &w->slot[s % NSLOT];
+    while((t = *tp) != 0){
+      if(t->when <= now){
+        *tp = t->next;
+        fire(t);
+      } else {
+        tp = &t->next;
+      }
+    }
+  }
+  w->clock = now;
+
+  w->next = ~0ULL;
+  for(i = 0; i < NSLOT; i++)
+    for(t = w->slot[i]; t; t = t->next)
+      if(t->when < w->next)
+        w->next = t->when;
+}
+
+// A timer interrupt, which timervec in kernelvec.S forwards as a
+// software interrupt, having disarmed the timer.  Returns 1 if a
+// tick has begun since the last one, so that the running process
+// has had its time slice; interrupts for deadlines and for the
+// profiler come in between.
+int
+timerintr(void)
+{
+  struct wheel *w = &wheel[cpuid()];
+  uint64 now = r_time();
+  int tick;
+
+  w->armed = ~0ULL;
+  acquire(&w->lock);
+  tick = now / TICKTIME != w->clock / TICKTIME;
+  expire(w, now);
+  timerarm();
+  release(&w->lock);
+  return tick;
+}
@@ -0,0 +1,145 @@
+// Kernel tracepoints.
+//
+// While tracing is on, TRACE() in defs.h records an event, with
+// the time, in the current CPU's ring.  Only that CPU writes its
+// ring, with interrupts off, so recording takes no lock; when a
+// ring is full the oldest events are overwritten.  ktrace(TRACE_READ)
+// drains the rings, and counts the events that were overwritten
+// before it got to them as lost.
+//
+// Times are values of the time CSR, which, unlike the cycle
+// counter, is the same clock on every CPU.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "trace.h"
+#include "defs.h"
+
+#define NTRACE 2048   // events per CPU
+
+struct tracebuf {
+  struct traceev ev[NTRACE];
+  uint64 head;        // events written; only this CPU changes it
+  uint64 tail;        // events read, or skipped as lost
+  uint lost;
+};
+
+struct {
+  struct spinlock lock;   // protects tail and lost
+  struct tracebuf buf[NCPU];
+} trace;
+
+int tracing;
+
+void
+traceinit(void)
+{
+  initlock(&trace.lock, "trace");
+}
+
+void
+tracerec(int type, int a, int b)
+{
+  struct proc *p = myproc();
+  struct tracebuf *t;
+  struct traceev *e;
+
+  push_off();
+  t = &trace.buf[cpuid()];
+  e = &t->ev[t->head % NTRACE];
+  e->time = r_time();
+  e->cpu = cpuid();
+  e->type = type;
+  e->pid = p ? p->pid : 0;
+  e->a = a;
+  e->b = b;
+  // the event must be complete before a reader can see it.
+  __sync_synchronize();
+  t->head++;
+  pop_off();
+}
+
+// Copy out up to n events to user address addr.  Returns how many.
+static int
+traceread(uint64 addr, int n)
+{
+  struct traceev ev[16];
+  struct tracebuf *t;
+  uint64 h;
+  int i, k, skip, got;
+
+  got = 0;
+  for(i = 0; i < NCPU && got < n; i++){
+    t = &trace.buf[i];
+    do {
+      acquire(&trace.lock);
+      h = t->head;
+      __sync_synchronize();
+      if(h - t->tail > NTRACE){
+        t->lost += h - t->tail - NTRACE;
+        t->tail = h - NTRACE;
+      }
+      for(k = 0; k < NELEM(ev) && got + k < n && t->tail + k < h; k++)
+        ev[k] = t->ev[(t->tail + k) % NTRACE];
+      // the CPU may have gone on to overwrite some of what
+      // was just copied, if the ring was nearly full.
+      __sync_synchronize();
+      h = t->head;
+      skip = 0;
+      if(h + 1 > t->tail + NTRACE)
+        skip = h + 1 - NTRACE - t->tail;
+      if(skip > k)
+        skip = k;
+      t->tail += k;
+      t->lost += skip;
+      release(&trace.lock);
+      if(copyout(myproc()->pagetable, addr + got * sizeof(ev[0]),
+                 (char*)&ev[skip], (k - skip) * sizeof(ev[0])) < 0)
+        return -1;
+      got += k - skip;
+    } while(k == NELEM(ev));
+  }
+  return got;
+}
+
+// The ktrace() system call; see trace.h.
+int
+ktrace(int cmd, uint64 addr, int n)
+{
+  struct tracebuf *t;
+  int lost;
+
+  switch(cmd){
+  case TRACE_START:
+    tracing = 0;
+    acquire(&trace.lock);
+    for(t = trace.buf; t < &trace.buf[NCPU]; t++){
+      t->tail = t->head;
+      t->lost = 0;
+    }
+    release(&trace.lock);
+    tracing = 1;
+    return 0;
+  case TRACE_STOP:
+    tracing = 0;
+    lost = 0;
+    acquire(&trace.lock);
+    for(t = trace.buf; t < &trace.buf[NCPU]; t++){
+      lost += t->lost;
+      if(t->head - t->tail > NTRACE)
+        lost += t->head - t->tail - NTRACE;
+    }
+    release(&trace.lock);
+    return lost;
+  case TRACE_READ:
+    if(n < 0)
+      return -1;
+    return traceread(addr, n);
+  }
+  return -1;
+}
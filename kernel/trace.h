@@ -0,0 +1,25 @@
+// Kernel trace events; see trace.c.
+
+// trace() commands
+#define TRACE_START 1    // discard old events and start tracing
+#define TRACE_STOP  2    // stop; returns how many events were lost
+#define TRACE_READ  3    // copy out and remove up to n events
+
+// event types, and what a and b hold
+#define TR_SYSCALL   1  // system call entered: number
+#define TR_SYSRET    2  // system call returned: number, return value
+#define TR_SWITCHIN  3  // scheduler() switched to the process
+#define TR_SWITCHOUT 4  // sched() switched away: the new state
+#define TR_BMISS     5  // bget() missed the cache: block, dev
+#define TR_COMMIT    6  // commit() began: blocks in the log
+#define TR_COMMITTED 7  // commit() finished
+#define TR_DISKDONE  8  // virtio_disk_intr() completed a request: block
+
+struct traceev {
+  uint64 time;     // the time CSR, TIMEFREQ a second
+  short cpu;
+  short type;
+  int pid;         // current process, or 0
+  int a;
+  int b;
+};
@@ -3,11 +3,11 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "defs.h"
 
 struct spinlock tickslock;
-uint ticks;
 
 extern char trampoline[], uservec[], userret[];
 
@@ -49,6 +49,9 @@ usertrap(void)
   
   // save user program counter.
   p->trapframe->epc = r_sepc();
+
+  // the time since usertrapret() was spent in user space.
+  rucharge(p, 1);
   
   if(r_scause() == 8){
     // system call
@@ -73,6 +76,10 @@ usertrap(void)
     p->killed = 1;
   }
 
+  // note where the process was, if profiling.
+  if(which_dev >= 2 && profiling)
+    profsample(1, p->trapframe->epc, p->trapframe->s0);
+
   if(p->killed)
     exit(-1);
 
@@ -91,6 +98,8 @@ usertrapret(void)
 {
   struct proc *p = myproc();
 
+  rucharge(p, 0);
+
   // we're about to switch the destination of traps from
   // kerneltrap() to usertrap(), so turn off interrupts until
   // we're back in user space, where usertrap() is correct.
@@ -121,11 +130,18 @@ usertrapret(void)
   // tell trampoline.S the user page table to switch to.
   uint64 satp = MAKE_SATP(p->pagetable);
 
+  // tell tlbshootdown() which page table this CPU is about
+  // to use; userret flushes the TLB as it switches to it.
+  struct cpu *c = mycpu();
+  c->upt = p->pagetable;
+  c->nflush++;
+  __sync_synchronize();
+
   // jump to trampoline.S at the top of memory, which 
   // switches to the user page table, restores user registers,
   // and switches to user mode with sret.
   uint64 fn = TRAMPOLINE + (userret - trampoline);
-  ((void (*)(uint64,uint64))fn)(TRAPFRAME, satp);
+  ((void (*)(uint64,uint64))fn)(p->trapva, satp);
 }
 
 // interrupts and exceptions from kernel code go here via kernelvec,
@@ -149,6 +165,12 @@ kerneltrap()
     panic("kerneltrap");
   }
 
+  // note where the kernel was, if profiling.  kernelvec
+  // leaves s0 alone, so the interrupted code's frame pointer
+  // is the one saved by this function's prologue.
+  if(which_dev >= 2 && profiling)
+    profsample(0, sepc, ((uint64*)r_fp())[-2]);
+
   // give up the CPU if this is a timer interrupt.
   if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
     yield();
@@ -159,18 +181,10 @@ kerneltrap()
   w_sstatus(sstatus);
 }
 
-void
-clockintr()
-{
-  acquire(&tickslock);
-  ticks++;
-  wakeup(&ticks);
-  release(&tickslock);
-}
-
 // check if it's an external interrupt or software interrupt,
 // and handle it.
-// returns 2 if timer interrupt,
+// returns 2 if timer interrupt at the end of a time slice,
+// 3 if other timer or software interrupt,
 // 1 if other device,
 // 0 if not recognized.
 int
@@ -202,17 +216,16 @@ devintr()
     return 1;
   } else if(scause == 0x8000000000000001L){
     // software interrupt from a machine-mode timer interrupt,
+    // or from another hart waking this one from idle(),
     // forwarded by timervec in kernelvec.S.
 
-    if(cpuid() == 0){
-      clockintr();
-    }
-    
     // acknowledge the software interrupt by clearing
     // the SSIP bit in sip.
     w_sip(r_sip() & ~2);
 
-    return 2;
+    if(timerintr())
+      return 2;
+    return 3;
   } else {
     return 0;
   }
@@ -0,0 +1,149 @@
+// Rings for submitting batches of system calls; see uring.h.
+//
+// Each ring has a worker, a kernel thread in its process's group
+// (see kclone()), so that it can use the process's memory and
+// open files.  uring_enter() passes queued operations on to the
+// worker and returns without waiting for them, unless asked to;
+// the worker carries them out one after the other, as the
+// equivalent system calls would, and posts each completion as
+// soon as it is done.  The process can go on meanwhile, and one
+// operation that blocks, such as a read of an empty pipe, holds
+// up only those queued behind it.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "uring.h"
+#include "defs.h"
+
+// protects the usq and ucq fields of every process with a ring.
+struct spinlock uring_lock;
+
+static void uringworker(void);
+
+void
+uringinit(void)
+{
+  initlock(&uring_lock, "uring");
+}
+
+// Give the calling process a ring page, mapped at URING, if it
+// has none.  Returns URING, or -1.  Threads made by clone() share
+// their leader's page table, so there is no room for a ring of
+// their own, and they cannot have one.
+uint64
+uringsetup(void)
+{
+  struct proc *p = myproc();
+  struct uring *r;
+
+  if(p->leader)
+    return -1;
+  if(p->uring)
+    return URING;
+  if((r = (struct uring*)kalloc()) == 0)
+    return -1;
+  memset(r, 0, PGSIZE);
+  if(mappages(p->pagetable, URING, PGSIZE, (uint64)r, PTE_R | PTE_W | PTE_U) < 0){
+    kfree((void*)r);
+    return -1;
+  }
+  p->usqhead = p->usqend = p->ucqtail = 0;
+  p->uring = r;
+  if(kclone("uring", uringworker) < 0){
+    p->uring = 0;
+    uvmunmap(p->pagetable, URING, 1, 0);
+    kfree((void*)r);
+    return -1;
+  }
+  return URING;
+}
+
+// Stop the worker of p's ring, then take the ring out of page
+// table pt and free it.
+void
+uringfree(struct proc *p, pagetable_t pt)
+{
+  if(p->uring == 0)
+    return;
+  killthreads(p);
+  uvmunmap(pt, URING, 1, 0);
+  kfree((void*)p->uring);
+  p->uring = 0;
+}
+
+// Pass up to n more queued operations on to the worker, then
+// wait until at least min completions are waiting for the
+// process to take, or until nothing passed on is still to
+// complete.  Returns how many operations were passed on.
+int
+uringenter(int n, int min)
+{
+  struct proc *p = myproc();
+  struct uring *r = p->uring;
+  uint queued;
+
+  if(r == 0 || n < 0 || min < 0)
+    return -1;
+  acquire(&uring_lock);
+  // the process may have moved sqtail anywhere; pass on at most
+  // what fits in the ring behind what the worker has not taken.
+  queued = r->sqtail - p->usqend;
+  if(queued > URING_NSQ - (p->usqend - p->usqhead))
+    queued = URING_NSQ - (p->usqend - p->usqhead);
+  if(n > queued)
+    n = queued;
+  p->usqend += n;
+  // the process may also have made room in the completion ring.
+  wakeup(&p->usqend);
+  while(p->ucqtail - r->cqhead < min && p->ucqtail != p->usqend && !p->killed)
+    sleep(r, &uring_lock);
+  release(&uring_lock);
+  return n;
+}
+
+// The body of a ring's worker.
+static void
+uringworker(void)
+{
+  struct proc *p = myproc();
+  struct proc *g = p->leader;
+  struct uring *r = g->uring;
+  struct usqe sqe;
+  struct ucqe *cqe;
+  int res;
+
+  acquire(&uring_lock);
+  for(;;){
+    // take an operation only when there will be room for its
+    // completion; the process makes room by advancing cqhead.
+    while(!p->killed && (g->usqhead == g->usqend ||
+                         g->ucqtail - r->cqhead >= URING_NCQ))
+      sleep(&g->usqend, &uring_lock);
+    if(p->killed)
+      break;
+    // copy the entry, so the process cannot change it under us.
+    sqe = r->sq[g->usqhead % URING_NSQ];
+    g->usqhead++;
+    r->sqhead = g->usqhead;
+    release(&uring_lock);
+
+    res = uringop(&sqe);
+    fdput();
+
+    acquire(&uring_lock);
+    cqe = &r->cq[g->ucqtail % URING_NCQ];
+    cqe->data = sqe.data;
+    cqe->res = res;
+    __sync_synchronize();
+    g->ucqtail++;
+    r->cqtail = g->ucqtail;
+    wakeup(r);
+  }
+  release(&uring_lock);
+  exit(0);
+}
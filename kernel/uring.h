@@ -0,0 +1,48 @@
+// Submission and completion rings shared by a process and the
+// kernel, in one page that uring_setup() maps into user memory.
+// The process fills in sq[sqtail % URING_NSQ] and advances sqtail,
+// then calls uring_enter(n, min) to pass the next n entries on to
+// the ring's worker and wait for min completions.  The worker
+// advances sqhead as it takes each entry and, once the operation
+// is done, fills in cq[cqtail % URING_NCQ] and advances cqtail.
+// Operations are taken and completed in order.  The process
+// consumes completions by advancing cqhead.  The counters only
+// ever increase.
+
+#define URING_NSQ 64     // power of 2
+#define URING_NCQ 64     // power of 2
+
+// operations
+#define UOP_NOP    0
+#define UOP_READ   1     // read(fd, addr, len), or pread() at off
+#define UOP_WRITE  2     // write(fd, addr, len), or pwrite() at off
+#define UOP_OPEN   3     // open(addr, flags)
+#define UOP_CLOSE  4     // close(fd)
+
+// submission queue entry
+struct usqe {
+  int op;
+  int fd;
+  int flags;        // UOP_OPEN's O_ flags
+  int len;
+  uint64 addr;      // buffer, or UOP_OPEN's path
+  int off;          // file offset, or -1 for the file's own
+  int pad;
+  uint64 data;      // copied to the completion, for the caller
+};
+
+// completion queue entry
+struct ucqe {
+  uint64 data;      // from the submission
+  int res;          // what the system call would have returned
+  int pad;
+};
+
+struct uring {
+  uint sqhead;      // next entry the kernel will take
+  uint sqtail;      // next entry the process will fill
+  uint cqhead;      // next completion the process will take
+  uint cqtail;      // next completion the kernel will fill
+  struct usqe sq[URING_NSQ];
+  struct ucqe cq[URING_NCQ];
+};
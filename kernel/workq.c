@@ -0,0 +1,149 @@
+// Per-CPU work queues.
+//
+// workq_add() arranges for a function to be called later by a
+// kernel thread, so that work such as freeing a dead process's
+// memory or a deleted file's blocks is not done on the latency
+// path of the system call that caused it.  Each CPU has its own
+// queue and its own worker thread, bound to that CPU, so work is
+// done where it was queued.  Work items come from a fixed pool;
+// when it is empty, workq_add() fails and the caller does the
+// work itself.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "defs.h"
+
+struct work {
+  void (*fn)(uint64, uint64);
+  uint64 a0;
+  uint64 a1;
+  struct work *next;
+};
+
+struct workq {
+  struct spinlock lock;
+  struct work *head;   // oldest first
+  struct work *tail;
+};
+
+struct workq workq[NCPU];
+
+struct {
+  struct spinlock lock;
+  struct work work[NWORK];
+  struct work *free;
+  int nbusy;           // queued or running
+} workpool;
+
+static void worker(void);
+
+void
+workqinit(void)
+{
+  struct work *w;
+  int i;
+
+  initlock(&workpool.lock, "workpool");
+  for(w = workpool.work; w < workpool.work+NWORK; w++){
+    w->next = workpool.free;
+    workpool.free = w;
+  }
+  for(i = 0; i < NCPU; i++)
+    initlock(&workq[i].lock, "workq");
+}
+
+// Start this CPU's worker thread.
+void
+workqinithart(void)
+{
+  char name[16];
+  int id = cpuid();
+
+  safestrcpy(name, "kworker0", sizeof(name));
+  name[7] = '0' + id;
+  if(kthread(name, worker, id) < 0)
+    panic("workqinithart");
+}
+
+// Queue fn(a0, a1) to be called by this CPU's worker thread.
+// Returns -1, having queued nothing, if no work item is free.
+// Must not be called holding a proc lock, since it calls wakeup().
+int
+workq_add(void (*fn)(uint64, uint64), uint64 a0, uint64 a1)
+{
+  struct work *w;
+  struct workq *q;
+
+  acquire(&workpool.lock);
+  if((w = workpool.free) != 0){
+    workpool.free = w->next;
+    workpool.nbusy++;
+  }
+  release(&workpool.lock);
+  if(w == 0)
+    return -1;
+
+  w->fn = fn;
+  w->a0 = a0;
+  w->a1 = a1;
+  w->next = 0;
+
+  push_off();
+  q = &workq[cpuid()];
+  pop_off();
+
+  acquire(&q->lock);
+  if(q->tail)
+    q->tail->next = w;
+  else
+    q->head = w;
+  q->tail = w;
+  wakeup(q);
+  release(&q->lock);
+  return 0;
+}
+
+// Wait until all queued work is done, e.g. before giving up
+// on allocating memory that queued work would free.
+void
+workq_drain(void)
+{
+  acquire(&workpool.lock);
+  while(workpool.nbusy > 0)
+    sleep(&workpool, &workpool.lock);
+  release(&workpool.lock);
+}
+
+static void
+worker(void)
+{
+  struct workq *q = &workq[myproc()->bindcpu];
+  struct work *w;
+
+  acquire(&q->lock);
+  for(;;){
+    if((w = q->head) == 0){
+      sleep(q, &q->lock);
+      continue;
+    }
+    if((q->head = w->next) == 0)
+      q->tail = 0;
+    release(&q->lock);
+
+    w->fn(w->a0, w->a1);
+
+    acquire(&workpool.lock);
+    w->next = workpool.free;
+    workpool.free = w;
+    if(--workpool.nbusy == 0)
+      wakeup(&workpool);
+    release(&workpool.lock);
+
+    acquire(&q->lock);
+  }
+}
@@ -0,0 +1,115 @@
+// Benchmark the block allocator: create several large files by
+// appending to them in turn, so that their blocks are allocated
+// interleaved, then read them back and delete them; then the same
+// with each file preallocated by fallocate() first.
+//
+// usage: allocbench [rounds]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/fs.h"
+#include "user/user.h"
+
+#define NF    4                     // files written at once
+#define FSZ   ((MAXFILE-1)*BSIZE)   // bytes per file
+#define CHUNK 512                   // bytes per append
+
+char buf[CHUNK];
+char name[] = "allocbench.0";
+int fd[NF];
+
+// Create the files, appending CHUNK bytes to each in turn.
+void
+create(int prealloc)
+{
+  int i, off;
+
+  for(i = 0; i < NF; i++){
+    name[sizeof(name)-2] = '0' + i;
+    if((fd[i] = open(name, O_CREATE|O_TRUNC|O_RDWR)) < 0){
+      fprintf(2, "allocbench: cannot create %s\n", name);
+      exit(1);
+    }
+    if(prealloc && fallocate(fd[i], 0, FSZ) < 0){
+      fprintf(2, "allocbench: fallocate failed\n");
+      exit(1);
+    }
+  }
+  for(off = 0; off < FSZ; off += CHUNK){
+    for(i = 0; i < NF; i++){
+      if(pwrite(fd[i], buf, CHUNK, off) != CHUNK){
+        fprintf(2, "allocbench: write failed\n");
+        exit(1);
+      }
+    }
+  }
+}
+
+void
+readback(void)
+{
+  int i, off;
+
+  for(i = 0; i < NF; i++){
+    for(off = 0; off < FSZ; off += CHUNK){
+      if(pread(fd[i], buf, CHUNK, off) != CHUNK){
+        fprintf(2, "allocbench: read failed\n");
+        exit(1);
+      }
+    }
+    close(fd[i]);
+  }
+}
+
+void
+delete(void)
+{
+  int i;
+
+  for(i = 0; i < NF; i++){
+    name[sizeof(name)-2] = '0' + i;
+    if(unlink(name) < 0){
+      fprintf(2, "allocbench: unlink failed\n");
+      exit(1);
+    }
+  }
+}
+
+void
+run(char *what, int prealloc, int rounds)
+{
+  int i, t0, tc, tr, td;
+
+  tc = tr = td = 0;
+  for(i = 0; i < rounds; i++){
+    t0 = millis();
+    create(prealloc);
+    tc += millis() - t0;
+    t0 = millis();
+    readback();
+    tr += millis() - t0;
+    t0 = millis();
+    delete();
+    td += millis() - t0;
+  }
+  printf("%s: %d rounds of %d files of %d KB: create %d, read %d, delete %d ms\n",
+         what, rounds, NF, FSZ / 1024, tc, tr, td);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds;
+
+  rounds = 5;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(rounds < 1)
+    rounds = 1;
+
+  memset(buf, 'a', sizeof(buf));
+  run("append", 0, rounds);
+  run("fallocate+write", 1, rounds);
+  exit(0);
+}
@@ -0,0 +1,106 @@
+// Timing for benchmarks.  start() lets user code read the cycle,
+// time and instret CSRs, so a program can time an operation far
+// shorter than the 100 ms tick that uptime() counts.
+//
+// The counters belong to the CPU, not the process: a run that is
+// preempted, or moves to another CPU, is timed with whatever ran
+// meanwhile, which is why bench() reports the minimum and median
+// of many runs rather than their mean.
+
+#include "kernel/types.h"
+#include "kernel/memlayout.h"
+#include "user/user.h"
+
+// clock cycles of this CPU.
+uint64
+rdcycle(void)
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
+// the time, TIMEFREQ a second, the same on every CPU.
+uint64
+rdtime(void)
+{
+  uint64 x;
+  asm volatile("csrr %0, time" : "=r" (x) );
+  return x;
+}
+
+// milliseconds since boot, for timing things too short for
+// uptime()'s 100 ms ticks.
+int
+millis(void)
+{
+  return rdtime() / (TIMEFREQ / 1000);
+}
+
+// instructions this CPU has retired.
+uint64
+rdinstret(void)
+{
+  uint64 x;
+  asm volatile("csrr %0, instret" : "=r" (x) );
+  return x;
+}
+
+static void
+sort(uint64 *a, int n)
+{
+  int i, j;
+  uint64 x;
+
+  for(i = 1; i < n; i++){
+    x = a[i];
+    for(j = i; j > 0 && a[j-1] > x; j--)
+      a[j] = a[j-1];
+    a[j] = x;
+  }
+}
+
+// Call fn() warmup times untimed, then reps times timed, and
+// print what a run of fn() took, where a run does ops operations:
+// the minimum, median and 99th percentile time, and operations
+// a second, cycles and instructions per operation at the median.
+void
+bench(char *name, void (*fn)(void), int warmup, int reps, int ops)
+{
+  uint64 *t, *c, *n, t0, c0, n0, tm;
+  int i;
+
+  if(reps < 1)
+    reps = 1;
+  if(ops < 1)
+    ops = 1;
+  if((t = malloc(3 * reps * sizeof(uint64))) == 0){
+    fprintf(2, "bench: out of memory\n");
+    exit(1);
+  }
+  c = t + reps;
+  n = c + reps;
+
+  for(i = 0; i < warmup; i++)
+    fn();
+  for(i = 0; i < reps; i++){
+    t0 = rdtime();
+    c0 = rdcycle();
+    n0 = rdinstret();
+    fn();
+    n[i] = rdinstret() - n0;
+    c[i] = rdcycle() - c0;
+    t[i] = rdtime() - t0;
+  }
+  sort(t, reps);
+  sort(c, reps);
+  sort(n, reps);
+
+  tm = t[reps/2] ? t[reps/2] : 1;
+  printf("%s: %d runs of %d ops: min %l us, median %l us, p99 %l us\n",
+         name, reps, ops, t[0] / (TIMEFREQ / 1000000),
+         tm / (TIMEFREQ / 1000000), t[reps*99/100] / (TIMEFREQ / 1000000));
+  printf("%s: %l ops/s, %l cycles/op, %l instructions/op\n",
+         name, (uint64)ops * TIMEFREQ / tm, c[reps/2] / ops, n[reps/2] / ops);
+  free(t);
+}
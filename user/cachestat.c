@@ -0,0 +1,53 @@
+// Print buffer and page cache hit ratios, either since boot
+// or while running a command.
+//
+// usage: cachestat [command args...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+void
+ratio(char *what, uint64 hit, uint64 miss)
+{
+  int n = hit + miss;
+
+  printf("%s: %d hits, %d misses", what, (int)hit, (int)miss);
+  if(n > 0)
+    printf(", %d%% hit", (int)(hit * 100 / n));
+  printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cachestat a, b;
+  int pid;
+
+  memset(&a, 0, sizeof(a));
+  if(argc > 1){
+    if(cachestat(&a) < 0){
+      fprintf(2, "cachestat: cachestat failed\n");
+      exit(1);
+    }
+    if((pid = fork()) < 0){
+      fprintf(2, "cachestat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      fprintf(2, "cachestat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+  if(cachestat(&b) < 0){
+    fprintf(2, "cachestat: cachestat failed\n");
+    exit(1);
+  }
+  ratio("buffer cache", b.bhit - a.bhit, b.bmiss - a.bmiss);
+  ratio("page cache", b.phit - a.phit, b.pmiss - a.pmiss);
+  printf("buffer cache: %d dirty buffers\n", b.ndirty);
+  printf("page cache: %d pages (%d KB) of file data\n", b.npage, b.npage * 4);
+  exit(0);
+}
@@ -0,0 +1,63 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+// Copy src to dst, or into dst if it is a directory.
+// The data is moved by the kernel with sendfile().
+
+char buf[512];
+
+int
+main(int argc, char *argv[])
+{
+  int in, out, n;
+  char *dst, *p;
+  struct stat st, sst;
+
+  if(argc != 3){
+    fprintf(2, "Usage: cp src dst\n");
+    exit(1);
+  }
+  if((in = open(argv[1], O_RDONLY)) < 0){
+    fprintf(2, "cp: cannot open %s\n", argv[1]);
+    exit(1);
+  }
+  if(fstat(in, &sst) < 0 || sst.type == T_DIR){
+    fprintf(2, "cp: %s is not a file\n", argv[1]);
+    exit(1);
+  }
+
+  dst = argv[2];
+  if(stat(dst, &st) == 0 && st.type == T_DIR){
+    for(p = argv[1] + strlen(argv[1]); p > argv[1] && p[-1] != '/'; p--)
+      ;
+    if(strlen(dst) + 1 + strlen(p) + 1 > sizeof(buf)){
+      fprintf(2, "cp: path too long\n");
+      exit(1);
+    }
+    strcpy(buf, dst);
+    strcpy(buf + strlen(buf), "/");
+    strcpy(buf + strlen(buf), p);
+    dst = buf;
+  }
+  // opening dst truncates it, so it must not be src.
+  if(stat(dst, &st) == 0 && st.dev == sst.dev && st.ino == sst.ino){
+    fprintf(2, "cp: %s and %s are the same file\n", argv[1], dst);
+    exit(1);
+  }
+  if((out = open(dst, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "cp: cannot create %s\n", dst);
+    exit(1);
+  }
+
+  while((n = sendfile(out, in, 64*1024)) > 0)
+    ;
+  if(n < 0){
+    fprintf(2, "cp: write %s failed\n", dst);
+    exit(1);
+  }
+  close(in);
+  close(out);
+  exit(0);
+}
@@ -0,0 +1,147 @@
+// Benchmark copying a file, to another file and to a pipe, with a
+// read/write loop through a user buffer and with sendfile(), which
+// copies inside the kernel.
+//
+// usage: cpbench [passes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/fs.h"
+#include "user/user.h"
+
+#define SRC     "cpbench.src"
+#define DST     "cpbench.dst"
+#define SIZE    (256*1024)   // must fit in MAXFILE blocks
+
+char buf[4096];
+
+// Copy in to out, using a user buffer of bufsz bytes,
+// or sendfile() if bufsz is 0.  Returns bytes copied.
+int
+copy(int out, int in, int bufsz)
+{
+  int n, tot;
+
+  tot = 0;
+  if(bufsz == 0){
+    while((n = sendfile(out, in, SIZE)) > 0)
+      tot += n;
+  } else {
+    while((n = read(in, buf, bufsz)) > 0){
+      if(write(out, buf, n) != n){
+        fprintf(2, "cpbench: write failed\n");
+        exit(1);
+      }
+      tot += n;
+    }
+  }
+  if(n < 0){
+    fprintf(2, "cpbench: copy failed\n");
+    exit(1);
+  }
+  return tot;
+}
+
+// Check that DST is a copy of SRC.
+void
+verify(void)
+{
+  static char a[1024], b[1024];
+  int fa, fb, n;
+
+  fa = open(SRC, O_RDONLY);
+  fb = open(DST, O_RDONLY);
+  while((n = read(fa, a, sizeof(a))) > 0){
+    if(read(fb, b, sizeof(b)) != n || memcmp(a, b, n) != 0){
+      fprintf(2, "cpbench: %s differs from %s\n", DST, SRC);
+      exit(1);
+    }
+  }
+  if(read(fb, b, sizeof(b)) != 0){
+    fprintf(2, "cpbench: %s is too long\n", DST);
+    exit(1);
+  }
+  close(fa);
+  close(fb);
+}
+
+// Copy SRC to DST, or to a pipe if topipe, passes times.
+void
+timecopy(char *what, int bufsz, int topipe, int passes)
+{
+  int i, in, out, p[2], n, tot, t0, t;
+
+  t0 = millis();
+  tot = 0;
+  for(i = 0; i < passes; i++){
+    in = open(SRC, O_RDONLY);
+    if(topipe){
+      if(pipe(p) < 0){
+        fprintf(2, "cpbench: pipe failed\n");
+        exit(1);
+      }
+      if(fork() == 0){
+        close(p[1]);
+        while((n = read(p[0], buf, sizeof(buf))) > 0)
+          ;
+        exit(0);
+      }
+      close(p[0]);
+      out = p[1];
+    } else {
+      out = open(DST, O_CREATE|O_TRUNC|O_WRONLY);
+    }
+    if(in < 0 || out < 0){
+      fprintf(2, "cpbench: cannot open files\n");
+      exit(1);
+    }
+    tot += copy(out, in, bufsz);
+    close(in);
+    close(out);
+    if(topipe)
+      wait(0);
+  }
+  t = millis() - t0;
+  if(!topipe)
+    verify();
+  if(t == 0)
+    t = 1;
+  printf("%s: %d KB, %d ms, %d KB/s\n", what, tot / 1024, t, tot / 1024 * 1000 / t);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int passes, fd, i;
+
+  passes = 4;
+  if(argc > 1)
+    passes = atoi(argv[1]);
+  if(passes < 1)
+    passes = 1;
+
+  if((fd = open(SRC, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "cpbench: cannot create %s\n", SRC);
+    exit(1);
+  }
+  for(i = 0; i < SIZE; i += sizeof(buf)){
+    memset(buf, 'a' + (i / sizeof(buf)) % 26, sizeof(buf));
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      fprintf(2, "cpbench: write %s failed\n", SRC);
+      exit(1);
+    }
+  }
+  close(fd);
+  printf("cpbench: %d KB file, %d passes\n", SIZE / 1024, passes);
+
+  timecopy("file read/write 512", 512, 0, passes);
+  timecopy("file read/write 4096", 4096, 0, passes);
+  timecopy("file sendfile", 0, 0, passes);
+  timecopy("pipe read/write 4096", 4096, 1, passes);
+  timecopy("pipe sendfile", 0, 1, passes);
+
+  unlink(SRC);
+  unlink(DST);
+  exit(0);
+}
@@ -0,0 +1,99 @@
+// Benchmark creating and removing many empty files, first on an
+// empty directory and then with most of the file system's inodes
+// already in use, where finding a free inode used to mean reading
+// most of the inode blocks.
+//
+// usage: createbench [files [rounds]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+char name[] = "cb/f00";
+
+void
+setname(int i)
+{
+  name[4] = 'a' + i / 10;
+  name[5] = '0' + i % 10;
+}
+
+void
+mkfiles(int lo, int hi)
+{
+  int i, fd;
+
+  for(i = lo; i < hi; i++){
+    setname(i);
+    if((fd = open(name, O_CREATE|O_RDWR)) < 0){
+      fprintf(2, "createbench: cannot create %s\n", name);
+      exit(1);
+    }
+    close(fd);
+  }
+}
+
+void
+rmfiles(int lo, int hi)
+{
+  int i;
+
+  for(i = lo; i < hi; i++){
+    setname(i);
+    if(unlink(name) < 0){
+      fprintf(2, "createbench: cannot remove %s\n", name);
+      exit(1);
+    }
+  }
+}
+
+// Create and remove files [lo, hi) rounds times; return ms taken.
+int
+churn(int lo, int hi, int rounds)
+{
+  int i, t0;
+
+  t0 = millis();
+  for(i = 0; i < rounds; i++){
+    mkfiles(lo, hi);
+    rmfiles(lo, hi);
+  }
+  return millis() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nfile, rounds, nfill, t;
+
+  nfile = 20;
+  rounds = 10;
+  if(argc > 1)
+    nfile = atoi(argv[1]);
+  if(argc > 2)
+    rounds = atoi(argv[2]);
+  // leave room for the files already on the disk.
+  if(nfile < 1 || nfile > NINODES / 4 || rounds < 1){
+    fprintf(2, "usage: createbench [files, at most %d [rounds]]\n", NINODES / 4);
+    exit(1);
+  }
+  if(mkdir("cb") < 0){
+    fprintf(2, "createbench: cannot make directory cb\n");
+    exit(1);
+  }
+
+  t = churn(0, nfile, rounds);
+  printf("empty: %d x %d files created and removed, %d ms\n", rounds, nfile, t);
+
+  // use up most of the inodes, then churn in what is left.
+  nfill = NINODES / 2;
+  mkfiles(nfile, nfile + nfill);
+  t = churn(0, nfile, rounds);
+  printf("%d more in use: %d x %d files created and removed, %d ms\n",
+         nfill, rounds, nfile, t);
+  rmfiles(nfile, nfile + nfill);
+  unlink("cb");
+  exit(0);
+}
@@ -2,57 +2,84 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fs.h"
+#include "kernel/fcntl.h"
 
-void find(char *path, char *target) {
-	char buf[512], *p;//完整路径长度，经验选择512
-	int fd;//用于标识打开文件或其他 I/O 设备的句柄,以便后续的文件操作可以使用它来引用打开的文件或设备。
-	struct dirent de;//表示目录中的条目（文件和子目录）
+// 完整路径，经验选择512，只用于输出；所有递归层共用，不放在栈上
+char buf[512];
+
+// dirfd 是已打开的目录，其路径在 buf 中、结束于 end，子目录用
+// openat 相对 dirfd 打开，内核每次只解析一级名字，不必从根重新遍历整条路径。
+// 用户栈只有一页，每层栈帧要小
+void find(int dirfd, char *end, char *target) {
+	char *p;
+	int fd, i, n;
+	struct dirstat ds[4];//目录中的条目（文件和子目录）及其 inode 属性
+
+	if(end + 1 + DIRSIZ + 1 > buf + sizeof buf){//超过512，寄
+		printf("find: path too long\n");
+		return;
+	}
+	p = end;
+	*p++ = '/';//放入/
+	// getdents 一次返回多个目录项及其类型，普通文件不必再 open+fstat
+	while((n = getdents(dirfd, ds, sizeof(ds)/sizeof(ds[0]))) > 0)
+    {
+		for(i = 0; i < n; i++){
+			strcpy(p, ds[i].name);
+			if(ds[i].type == T_FILE){
+				if(strcmp(ds[i].name, target) == 0)
+					printf("%s\n", buf);
+			} else if(ds[i].type == T_DIR){
+				// Don't recurse into "." and ".." ！ ！ ！ ！ ！
+				if(strcmp(ds[i].name, ".") == 0 || strcmp(ds[i].name, "..") == 0)
+					continue;
+				if((fd = openat(dirfd, ds[i].name, O_RDONLY)) < 0){
+					printf("find: cannot open %s\n", buf);
+					continue;
+				}
+				find(fd, p + strlen(p), target); // 递归
+				close(fd);
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int fd;
 	struct stat st;
+	char *path, *target;
+
+	if(argc < 3) exit(0);
+	path = argv[1];//要搜索的起始目录的路径
+	target = argv[2];//要查找的目标文件的名称
 	if((fd = open(path, 0)) < 0)
     {//打不开
 		printf("find: cannot open %s\n", path);
-		return;
+		exit(0);
 	}
-	if(fstat(fd, &st) < 0)//权限检查、文件大小计算、时间戳的管理等
+	if(fstat(fd, &st) < 0)
     {//无法获取状态信息
 		printf("find: cannot stat %s\n", path);
 		close(fd);
-		return;
+		exit(0);
 	}
-
-	switch(st.type){//类型-文件/文件夹 
-	case T_FILE:// 文件名后缀匹配
-		if(strcmp(path+strlen(path)-strlen(target), target) == 0) 
+	switch(st.type){//类型-文件/文件夹
+	case T_FILE:// 文件名后缀匹配，防止前面还有/
+		if(strlen(path) >= strlen(target)+1 &&
+		   strcmp(path+strlen(path)-strlen(target), target) == 0 &&
+		   path[strlen(path)-strlen(target)-1] == '/')
 			printf("%s\n", path);
 		break;
-	case T_DIR://文件夹 
-		if(strlen(path) + 1 + DIRSIZ + 1 > sizeof buf){//超过512，寄
+	case T_DIR://文件夹
+		if(strlen(path) + 1 > sizeof buf){
 			printf("find: path too long\n");
 			break;
 		}
-		strcpy(buf, path);//buf=path 
-		p = buf+strlen(buf);//指向buf后
-		*p++ = '/';//放入/
-		while(read(fd, &de, sizeof(de)) == sizeof(de))//sizeof(de)=2+14
-        {//从目录文件fd中读取一个目录项，并存在de中。每次调用read会读取下一个目录项，确保了每次迭代都处理一层路径。
-			if(de.inum == 0) continue;//该目录项无效
-			memmove(p, de.name, DIRSIZ);//memcpy 14
-			p[DIRSIZ] = 0;//确保字符串以 null 结尾
-			// Don't recurse into "." and ".." ！ ！ ！ ！ ！ 
-			if(strcmp(buf+strlen(buf)-2, "/.") != 0 && strcmp(buf+strlen(buf)-3, "/..") != 0) 
-				find(buf, target); // 递归
-		}
+		strcpy(buf, path);//buf=path
+		find(fd, buf + strlen(buf), target);
 		break;
 	}
 	close(fd);
-}
-
-int main(int argc, char *argv[])
-{
-	if(argc < 3) exit(0);
-	char target[512];//要查找的目标文件
-	target[0] = '/'; // 后缀匹配，防止前面还有//默认根目录下运行
-	strcpy(target+1, argv[2]);//要查找的目标文件的名称
-	find(argv[1], target);//argv[1]要搜索的起始目录的路径
 	exit(0);
 }
@@ -0,0 +1,222 @@
+// Benchmark directory traversal.  Populates a wide tree of
+// directories and files and times repeated runs of find over the
+// whole file system, then does the same for a deep chain of nested
+// directories.
+//
+// usage: findbench [passes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define WIDE    "fbtree"
+#define NDIR    4       // subdirectories per directory in the wide tree
+#define DEPTH   2       // levels of subdirectories in the wide tree
+#define NFILE   4       // files per directory
+#define DEEP    "fbdeep"
+#define NDEEP   10      // levels in the deep chain; find keeps a fd open per level, of NOFILE (16)
+
+char path[128];
+int ndirs, nfiles;
+
+// Append "/<c><i>" to path, which ends at p; return the new end.
+char*
+addname(char *p, char c, int i)
+{
+  *p++ = '/';
+  *p++ = c;
+  *p++ = '0' + i;
+  *p = '\0';
+  return p;
+}
+
+// Populate the directory named by path, which ends at end.
+void
+populate(char *end, int depth)
+{
+  int i, fd;
+
+  for(i = 0; i < NFILE; i++){
+    addname(end, 'f', i);
+    if((fd = open(path, O_CREATE|O_WRONLY)) < 0){
+      fprintf(2, "findbench: cannot create %s\n", path);
+      exit(1);
+    }
+    close(fd);
+    nfiles++;
+  }
+  if(depth == DEPTH)
+    return;
+  for(i = 0; i < NDIR; i++){
+    char *e = addname(end, 'd', i);
+    if(mkdir(path) < 0){
+      fprintf(2, "findbench: cannot mkdir %s\n", path);
+      exit(1);
+    }
+    ndirs++;
+    populate(e, depth+1);
+  }
+  *end = '\0';
+}
+
+// Remove everything below path, which ends at end.
+void
+depopulate(char *end, int depth)
+{
+  int i;
+
+  for(i = 0; i < NFILE; i++){
+    addname(end, 'f', i);
+    unlink(path);
+  }
+  if(depth < DEPTH){
+    for(i = 0; i < NDIR; i++){
+      char *e = addname(end, 'd', i);
+      depopulate(e, depth+1);
+      addname(end, 'd', i);
+      unlink(path);
+    }
+  }
+  *end = '\0';
+}
+
+// Fill the directory open as fd with NFILE files and, below
+// depth NDEEP, a subdirectory d0 filled the same way.
+void
+mkdeep(int fd, int depth)
+{
+  char name[3];
+  int i, f;
+
+  name[0] = 'f';
+  name[2] = '\0';
+  for(i = 0; i < NFILE; i++){
+    name[1] = '0' + i;
+    if((f = openat(fd, name, O_CREATE|O_WRONLY)) < 0){
+      fprintf(2, "findbench: cannot create %s at depth %d\n", name, depth);
+      exit(1);
+    }
+    close(f);
+    nfiles++;
+  }
+  if(depth == NDEEP)
+    return;
+  if(mkdirat(fd, "d0") < 0 || (f = openat(fd, "d0", O_RDONLY)) < 0){
+    fprintf(2, "findbench: cannot mkdir d0 at depth %d\n", depth);
+    exit(1);
+  }
+  ndirs++;
+  mkdeep(f, depth+1);
+  close(f);
+}
+
+void
+rmdeep(int fd, int depth)
+{
+  char name[3];
+  int i, f;
+
+  if(depth < NDEEP && (f = openat(fd, "d0", O_RDONLY)) >= 0){
+    rmdeep(f, depth+1);
+    close(f);
+    unlinkat(fd, "d0");
+  }
+  name[0] = 'f';
+  name[2] = '\0';
+  for(i = 0; i < NFILE; i++){
+    name[1] = '0' + i;
+    unlinkat(fd, name);
+  }
+}
+
+// Run find dir f0 and return the number of lines it prints.
+int
+runfind(char *dir)
+{
+  int p[2], n, i, lines;
+  char buf[512];
+  char *argv[] = { "find", dir, "f0", 0 };
+
+  if(pipe(p) < 0){
+    fprintf(2, "findbench: pipe failed\n");
+    exit(1);
+  }
+  if(fork() == 0){
+    close(1);
+    dup(p[1]);
+    close(p[0]);
+    close(p[1]);
+    exec("find", argv);
+    fprintf(2, "findbench: exec find failed\n");
+    exit(1);
+  }
+  close(p[1]);
+  lines = 0;
+  while((n = read(p[0], buf, sizeof(buf))) > 0)
+    for(i = 0; i < n; i++)
+      if(buf[i] == '\n')
+        lines++;
+  close(p[0]);
+  wait(0);
+  return lines;
+}
+
+// Time passes runs of find in dir.  If want >= 0, each run must
+// find exactly that many files, or find did not get to the bottom.
+void
+timefind(char *dir, int passes, int want)
+{
+  int i, t0, t, n, found;
+
+  found = 0;
+  t0 = millis();
+  for(i = 0; i < passes; i++){
+    n = runfind(dir);
+    if(want >= 0 && n != want){
+      fprintf(2, "findbench: find %s found %d, want %d\n", dir, n, want);
+      exit(1);
+    }
+    found += n;
+  }
+  t = millis() - t0;
+  printf("find %s: %d passes, %d found, %d ms, %d ms/pass\n",
+         dir, passes, found, t, t / passes);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int passes, fd;
+
+  passes = 20;
+  if(argc > 1)
+    passes = atoi(argv[1]);
+  if(passes < 1)
+    passes = 1;
+
+  strcpy(path, WIDE);
+  if(mkdir(path) < 0){
+    fprintf(2, "findbench: cannot mkdir %s\n", path);
+    exit(1);
+  }
+  populate(path + strlen(path), 0);
+  printf("findbench: %d directories, %d files under %s\n", ndirs, nfiles, WIDE);
+  timefind("/", passes, -1);
+  depopulate(path + strlen(path), 0);
+  unlink(path);
+
+  ndirs = nfiles = 0;
+  if(mkdir(DEEP) < 0 || (fd = open(DEEP, O_RDONLY)) < 0){
+    fprintf(2, "findbench: cannot mkdir %s\n", DEEP);
+    exit(1);
+  }
+  mkdeep(fd, 0);
+  printf("findbench: %d nested directories, %d files under %s\n", ndirs, nfiles, DEEP);
+  timefind(DEEP, passes, NDEEP+1);
+  rmdeep(fd, 0);
+  close(fd);
+  unlink(DEEP);
+
+  exit(0);
+}
@@ -1,5 +1,7 @@
-// Test that fork fails gracefully.
-// Tiny executable so that the limit can be filling the proc table.
+// Test that fork fails gracefully, then time fork, exit and wait.
+// The test is that fork fails once the proc table is full, so the
+// NPROC copies must fit in memory: with printf and malloc for
+// bench() each copy is still only a few pages, so they do.
 
 #include "kernel/types.h"
 #include "kernel/stat.h"
@@ -48,9 +50,26 @@ forktest(void)
   print("fork test OK\n");
 }
 
+// One child that exits at once.
+void
+forkone(void)
+{
+  int pid;
+
+  pid = fork();
+  if(pid < 0){
+    print("fork failed\n");
+    exit(1);
+  }
+  if(pid == 0)
+    exit(0);
+  wait(0);
+}
+
 int
 main(void)
 {
   forktest();
+  bench("fork+exit+wait", forkone, 10, 100, 1);
   exit(0);
 }
@@ -1,52 +1,322 @@
 // Simple grep.  Only supports ^ . * $ operators.
+//
+// The pattern is compiled to a list of atoms and run as a lazily
+// built DFA, so each input byte is looked at once per line instead
+// of once per starting offset.  If the pattern contains plain
+// literal characters, the longest run of them is searched for with
+// memchr() first, and lines that cannot contain it are skipped
+// without running the DFA at all.  Patterns with more atoms than
+// the DFA's state sets can hold fall back to the backtracking
+// matcher from Kernighan & Pike.
 
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "user/user.h"
 
-char buf[1024];
+#define MAXATOM  63     // atoms per pattern the DFA can handle
+#define NDSTATE  64     // DFA states cached before starting over
+#define BUFSZ    (64*1024)  // initial input buffer; grows for long lines
+
+struct atom {
+  char c;       // character to match, or '.' for any
+  char star;    // followed by '*'?
+};
+
+struct {
+  char *re;             // the pattern as given
+  int bol;              // anchored at beginning of line by ^
+  int eol;              // anchored at end of line by $
+  int natom;            // number of atoms, or -1 if too many
+  struct atom atom[MAXATOM];
+  char *lit;            // longest run of plain characters in re
+  int nlit;
+} pat;
+
+// DFA states are sets of NFA states; NFA state i means the first i
+// atoms have matched.  dnext[s][c] caches the state reached from s
+// on byte c, or -1 if it has not been computed yet.  State 0 is
+// always the start state.
+uint64 dset[NDSTATE];
+short dnext[NDSTATE][256];
+int ndstate;
+int nflush;
+uint64 accept;
+
+char *buf;
+int bufsz;
+
+char obuf[4096];
+int nout;
+
 int match(char*, char*);
 
 void
-grep(char *pattern, int fd)
+compile(char *re)
+{
+  int i, run;
+
+  pat.re = re;
+  pat.bol = 0;
+  pat.eol = 0;
+  pat.natom = 0;
+  pat.lit = 0;
+  pat.nlit = 0;
+
+  i = 0;
+  if(re[0] == '^'){
+    pat.bol = 1;
+    i++;
+  }
+  run = 0;
+  while(re[i] != '\0'){
+    if(re[i] == '$' && re[i+1] == '\0'){
+      pat.eol = 1;
+      break;
+    }
+    if(pat.natom == MAXATOM){
+      pat.natom = -1;
+      return;
+    }
+    pat.atom[pat.natom].c = re[i];
+    pat.atom[pat.natom].star = (re[i+1] == '*');
+    if(re[i] != '.' && re[i+1] != '*'){
+      // plain atoms are single characters, so a run of them is
+      // also a run of characters in re that every match contains.
+      if(++run > pat.nlit){
+        pat.lit = &re[i+1-run];
+        pat.nlit = run;
+      }
+    } else {
+      run = 0;
+    }
+    i += pat.atom[pat.natom].star ? 2 : 1;
+    pat.natom++;
+  }
+}
+
+// Add the NFA states reachable by skipping starred atoms.
+uint64
+closure(uint64 s)
+{
+  int i;
+
+  for(i = 0; i < pat.natom; i++)
+    if((s & ((uint64)1 << i)) && pat.atom[i].star)
+      s |= (uint64)1 << (i+1);
+  return s;
+}
+
+// Return the NFA state set reached from s on byte c.
+uint64
+step(uint64 s, int c)
+{
+  uint64 t;
+  int i;
+
+  t = 0;
+  for(i = 0; i < pat.natom; i++){
+    if((s & ((uint64)1 << i)) == 0)
+      continue;
+    if(pat.atom[i].c == '.' || (uchar)pat.atom[i].c == c)
+      t |= (uint64)1 << (pat.atom[i].star ? i : i+1);
+  }
+  if(!pat.bol)
+    t |= 1;  // a match may begin at any offset
+  return closure(t);
+}
+
+// Find or add the DFA state for NFA state set s.
+// When the cache is full it is flushed and rebuilt lazily.
+int
+dstate(uint64 s)
+{
+  int i;
+
+  for(i = 0; i < ndstate; i++)
+    if(dset[i] == s)
+      return i;
+  if(ndstate == NDSTATE){
+    // keep only the start state.
+    nflush++;
+    ndstate = 1;
+    memset(dnext[0], 0xff, sizeof(dnext[0]));
+    if(dset[0] == s)
+      return 0;
+  }
+  dset[ndstate] = s;
+  memset(dnext[ndstate], 0xff, sizeof(dnext[0]));
+  return ndstate++;
+}
+
+void
+dfainit(void)
+{
+  ndstate = 0;
+  nflush = 0;
+  accept = (uint64)1 << pat.natom;
+  dstate(closure(1));
+}
+
+// Does the line p[0..n-1] (no newline) match?
+int
+dfamatch(char *p, int n)
+{
+  int i, s, t, f;
+
+  s = 0;
+  for(i = 0; i < n; i++){
+    if(!pat.eol && (dset[s] & accept))
+      return 1;
+    if(dset[s] == 0)
+      return 0;  // anchored pattern that can no longer match
+    if((t = dnext[s][(uchar)p[i]]) < 0){
+      f = nflush;
+      t = dstate(step(dset[s], (uchar)p[i]));
+      if(f == nflush)
+        dnext[s][(uchar)p[i]] = t;
+    }
+    s = t;
+  }
+  return (dset[s] & accept) != 0;
+}
+
+int
+matchline(char *p, int n)
+{
+  char c;
+  int r;
+
+  if(pat.natom >= 0)
+    return dfamatch(p, n);
+
+  // too many atoms for the DFA.
+  // buf always has room for the terminating nul.
+  c = p[n];
+  p[n] = '\0';
+  r = match(pat.re, p);
+  p[n] = c;
+  return r;
+}
+
+void
+flush(void)
+{
+  if(nout > 0)
+    write(1, obuf, nout);
+  nout = 0;
+}
+
+// Buffer output so that many matching lines cost one write().
+void
+emit(char *p, int n)
+{
+  if(nout + n > sizeof(obuf))
+    flush();
+  if(n >= sizeof(obuf)){
+    write(1, p, n);
+    return;
+  }
+  memmove(obuf+nout, p, n);
+  nout += n;
+}
+
+// Find the longest literal of the pattern in p[0..end).
+char*
+findlit(char *p, char *end)
+{
+  char *last;
+
+  last = end - pat.nlit;
+  while(p <= last && (p = memchr(p, pat.lit[0], last - p + 1)) != 0){
+    if(memcmp(p, pat.lit, pat.nlit) == 0)
+      return p;
+    p++;
+  }
+  return 0;
+}
+
+// Print the lines in p[0..end) that match.
+// Every line ends in a newline except perhaps the last.
+void
+scan(char *p, char *end)
+{
+  char *q, *nl;
+
+  while(p < end){
+    if(pat.nlit > 0){
+      if((q = findlit(p, end)) == 0)
+        return;
+      // back up to the start of the line holding the literal.
+      while(q > p && q[-1] != '\n')
+        q--;
+      p = q;
+    }
+    if((nl = memchr(p, '\n', end - p)) == 0)
+      nl = end;
+    if(matchline(p, nl - p)){
+      if(nl < end){
+        emit(p, nl+1 - p);
+      } else {
+        emit(p, nl - p);
+        emit("\n", 1);
+      }
+    }
+    p = nl + 1;
+  }
+}
+
+void
+grep(int fd)
 {
   int n, m;
-  char *p, *q;
+  char *p, *nbuf;
 
   m = 0;
-  while((n = read(fd, buf+m, sizeof(buf)-m-1)) > 0){
+  while((n = read(fd, buf+m, bufsz-m-1)) > 0){
     m += n;
-    buf[m] = '\0';
-    p = buf;
-    while((q = strchr(p, '\n')) != 0){
-      *q = 0;
-      if(match(pattern, p)){
-        *q = '\n';
-        write(1, p, q+1 - p);
-      }
-      p = q+1;
-    }
-    if(m > 0){
-      m -= p - buf;
+    for(p = buf+m; p > buf && p[-1] != '\n'; p--)
+      ;
+    scan(buf, p);
+    m -= p - buf;
+    if(m > 0)
       memmove(buf, p, m);
+    if(m == bufsz-1){
+      // a single line fills the buffer.
+      if((nbuf = malloc(2*bufsz)) == 0){
+        fprintf(2, "grep: line too long\n");
+        exit(1);
+      }
+      memmove(nbuf, buf, m);
+      free(buf);
+      buf = nbuf;
+      bufsz *= 2;
     }
   }
+  if(m > 0)
+    scan(buf, buf+m);
+  flush();
 }
 
 int
 main(int argc, char *argv[])
 {
   int fd, i;
-  char *pattern;
 
   if(argc <= 1){
     fprintf(2, "usage: grep pattern [file ...]\n");
     exit(1);
   }
-  pattern = argv[1];
+  compile(argv[1]);
+  if(pat.natom >= 0)
+    dfainit();
+  bufsz = BUFSZ;
+  if((buf = malloc(bufsz)) == 0){
+    fprintf(2, "grep: out of memory\n");
+    exit(1);
+  }
 
   if(argc <= 2){
-    grep(pattern, 0);
+    grep(0);
     exit(0);
   }
 
@@ -55,7 +325,7 @@ main(int argc, char *argv[])
       printf("grep: cannot open %s\n", argv[i]);
       exit(1);
     }
-    grep(pattern, fd);
+    grep(fd);
     close(fd);
   }
   exit(0);
@@ -102,4 +372,3 @@ int matchstar(int c, char *re, char *text)
   }while(*text!='\0' && (*text++==c || c=='.'));
   return 0;
 }
-
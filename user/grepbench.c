@@ -0,0 +1,157 @@
+// Benchmark grep over a file as large as the file system allows.
+// Runs grep on it several times for each of a few patterns and
+// reports bytes scanned and matching lines per second.
+//
+// usage: grepbench [passes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/fs.h"
+#include "user/user.h"
+
+#define FILE    "grepbench.dat"
+#define NLINE   4000
+#define NEEDLE  16      // every NEEDLE'th line contains "needle"
+
+char *patterns[] = {
+  "needle",             // literal: prefilter does all the work
+  "ne.dle",             // prefilter on "dle", DFA confirms
+  "^line .*7 the",      // anchored, no long literal
+  "q.*u.*i.*c.*k.*z",   // many states, matches nothing
+  0,
+};
+
+char buf[4096];
+
+// Format n in decimal at p; return the number of characters.
+int
+fmtint(char *p, int n)
+{
+  char tmp[12];
+  int i, k;
+
+  i = 0;
+  do{
+    tmp[i++] = '0' + n % 10;
+  }while((n /= 10) != 0);
+  for(k = 0; k < i; k++)
+    p[k] = tmp[i-1-k];
+  return i;
+}
+
+int
+append(char *p, char *s)
+{
+  int n = strlen(s);
+  memmove(p, s, n);
+  return n;
+}
+
+// Create the input file and return its size in bytes.
+int
+mkinput(void)
+{
+  int fd, i, n, tot;
+  char line[128];
+
+  if((fd = open(FILE, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "grepbench: cannot create %s\n", FILE);
+    exit(1);
+  }
+  n = 0;
+  tot = 0;
+  for(i = 0; i < NLINE; i++){
+    int k = 0;
+    k += append(line+k, "line ");
+    k += fmtint(line+k, i);
+    k += append(line+k, " the quick brown ");
+    k += append(line+k, i % NEEDLE == 0 ? "needle" : "fox");
+    k += append(line+k, " jumps over the lazy dog\n");
+    if(tot + n + k > MAXFILE*BSIZE)
+      break;
+    if(n + k > sizeof(buf)){
+      if(write(fd, buf, n) != n){
+        fprintf(2, "grepbench: write failed\n");
+        exit(1);
+      }
+      tot += n;
+      n = 0;
+    }
+    memmove(buf+n, line, k);
+    n += k;
+  }
+  if(write(fd, buf, n) != n){
+    fprintf(2, "grepbench: write failed\n");
+    exit(1);
+  }
+  tot += n;
+  close(fd);
+  return tot;
+}
+
+// Run grep pattern FILE, returning the number of lines it prints.
+int
+rungrep(char *pattern)
+{
+  int p[2], n, i, lines;
+  char *argv[4];
+
+  if(pipe(p) < 0){
+    fprintf(2, "grepbench: pipe failed\n");
+    exit(1);
+  }
+  argv[0] = "grep";
+  argv[1] = pattern;
+  argv[2] = FILE;
+  argv[3] = 0;
+  if(fork() == 0){
+    close(1);
+    dup(p[1]);
+    close(p[0]);
+    close(p[1]);
+    exec("grep", argv);
+    fprintf(2, "grepbench: exec grep failed\n");
+    exit(1);
+  }
+  close(p[1]);
+  lines = 0;
+  while((n = read(p[0], buf, sizeof(buf))) > 0)
+    for(i = 0; i < n; i++)
+      if(buf[i] == '\n')
+        lines++;
+  close(p[0]);
+  wait(0);
+  return lines;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int passes, size, i, j, t0, t, matches;
+
+  passes = 10;
+  if(argc > 1)
+    passes = atoi(argv[1]);
+  if(passes < 1)
+    passes = 1;
+
+  size = mkinput();
+  printf("grepbench: %d KB file, %d passes per pattern\n", size / 1024, passes);
+
+  for(i = 0; patterns[i]; i++){
+    matches = 0;
+    t0 = millis();
+    for(j = 0; j < passes; j++)
+      matches += rungrep(patterns[i]);
+    t = millis() - t0;
+    if(t == 0)
+      t = 1;
+    printf("%s: %d KB, %d matches, %d ms, %d KB/s, %d matches/s\n",
+           patterns[i], (size / 1024) * passes, matches, t,
+           (size / 1024) * passes * 1000 / t, matches * 1000 / t);
+  }
+
+  unlink(FILE);
+  exit(0);
+}
@@ -0,0 +1,85 @@
+// Benchmark the cost of switching between green threads, which
+// switch in user space (see gthread.c), against switching between
+// processes that ping-pong a byte over a pair of pipes, as
+// pingpong does.
+//
+// usage: gtbench [rounds]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/memlayout.h"
+#include "user/user.h"
+
+int rounds;
+
+void
+yielder(void *arg)
+{
+  int i;
+
+  for(i = 0; i < rounds; i++)
+    gthread_yield();
+}
+
+// Print the time per switch, from t counts of the time CSR.
+void
+report(char *what, int nswitch, uint64 t)
+{
+  printf("%s: %d switches, %d ms, %d ns per switch\n",
+         what, nswitch, (int)(t / (TIMEFREQ / 1000)),
+         (int)(t * (1000000000 / TIMEFREQ) / nswitch));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, ptc[2], ctp[2], pid;
+  uint64 t0;
+  char c;
+
+  rounds = 10000;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(rounds < 1)
+    rounds = 1;
+
+  // green threads: 100 times as many rounds, since they are cheap.
+  rounds *= 100;
+  if(gthread_create(yielder, 0) < 0 || gthread_create(yielder, 0) < 0){
+    fprintf(2, "gtbench: gthread_create failed\n");
+    exit(1);
+  }
+  t0 = rdtime();
+  gthread_run();
+  report("green threads", 2 * rounds, rdtime() - t0);
+  rounds /= 100;
+
+  // processes.
+  if(pipe(ptc) < 0 || pipe(ctp) < 0){
+    fprintf(2, "gtbench: pipe failed\n");
+    exit(1);
+  }
+  t0 = rdtime();
+  if((pid = fork()) < 0){
+    fprintf(2, "gtbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < rounds; i++){
+      if(read(ptc[0], &c, 1) != 1)
+        exit(1);
+      write(ctp[1], &c, 1);
+    }
+    exit(0);
+  }
+  for(i = 0; i < rounds; i++){
+    write(ptc[1], "p", 1);
+    if(read(ctp[0], &c, 1) != 1){
+      fprintf(2, "gtbench: read failed\n");
+      exit(1);
+    }
+  }
+  wait(0);
+  report("processes over pipes", 2 * rounds, rdtime() - t0);
+  exit(0);
+}
@@ -0,0 +1,179 @@
+// Green threads: cooperative threads inside one process, which
+// switch to each other in user space with gswtch.S, without
+// entering the kernel.  A thread runs until it calls
+// gthread_yield() or gthread_exit(), or returns from its function;
+// runnable threads take turns in the order they became runnable.
+//
+// gthread_create() makes a thread; gthread_run() runs the threads
+// until every one has exited, and then returns.  gthread_read()
+// and gthread_write() let the other threads run while a thread
+// waits for a pipe or the console.
+
+#include "kernel/types.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define GSTACKSZ 8192
+
+// Saved registers for green thread switches; the same
+// layout as the kernel's struct context.
+struct gcontext {
+  uint64 ra;
+  uint64 sp;
+
+  // callee-saved
+  uint64 s0;
+  uint64 s1;
+  uint64 s2;
+  uint64 s3;
+  uint64 s4;
+  uint64 s5;
+  uint64 s6;
+  uint64 s7;
+  uint64 s8;
+  uint64 s9;
+  uint64 s10;
+  uint64 s11;
+};
+
+struct gthread {
+  struct gcontext context;
+  void (*fn)(void*);
+  void *arg;
+  char *stack;
+  struct gthread *next;   // on the run queue or the free list
+};
+
+void gswtch(struct gcontext*, struct gcontext*);
+
+static struct gcontext runcontext;  // gthread_run()'s
+static struct gcontext deadcontext; // where exiting threads save
+static struct gthread *current;     // running thread, or 0
+static struct gthread *head;        // run queue
+static struct gthread *tail;
+static struct gthread *freelist;    // exited threads, for reuse
+
+static void
+enqueue(struct gthread *t)
+{
+  t->next = 0;
+  if(tail)
+    tail->next = t;
+  else
+    head = t;
+  tail = t;
+}
+
+// Save registers in old and run the next runnable thread,
+// or return to gthread_run() if there is none.
+static void
+schedule(struct gcontext *old)
+{
+  struct gthread *t;
+
+  if((t = head) == 0){
+    current = 0;
+    gswtch(old, &runcontext);
+    return;
+  }
+  if((head = t->next) == 0)
+    tail = 0;
+  current = t;
+  gswtch(old, &t->context);
+}
+
+// A new thread starts here.
+static void
+gthread_start(void)
+{
+  current->fn(current->arg);
+  gthread_exit();
+}
+
+// Make a thread that will call fn(arg).
+// Returns 0, or -1 if out of memory.
+int
+gthread_create(void (*fn)(void*), void *arg)
+{
+  struct gthread *t;
+
+  if((t = freelist) != 0){
+    freelist = t->next;
+  } else {
+    if((t = malloc(sizeof(*t))) == 0)
+      return -1;
+    if((t->stack = malloc(GSTACKSZ)) == 0){
+      free(t);
+      return -1;
+    }
+  }
+  memset(&t->context, 0, sizeof(t->context));
+  t->context.ra = (uint64)gthread_start;
+  t->context.sp = (uint64)(t->stack + GSTACKSZ);
+  t->fn = fn;
+  t->arg = arg;
+  enqueue(t);
+  return 0;
+}
+
+// Let the other runnable threads run.
+void
+gthread_yield(void)
+{
+  struct gthread *t = current;
+
+  if(t == 0 || head == 0)
+    return;
+  enqueue(t);
+  schedule(&t->context);
+}
+
+void
+gthread_exit(void)
+{
+  struct gthread *t = current;
+
+  // nothing else runs before this thread's stack is
+  // off the CPU, so it is safe to put on the free list now.
+  t->next = freelist;
+  freelist = t;
+  schedule(&deadcontext);
+}
+
+// Let the other threads run until fd is ready for events.
+// If no other thread is runnable, return at once, so that
+// the caller blocks in the kernel instead of spinning.
+static void
+waitfd(int fd, int events)
+{
+  struct pollfd pfd;
+
+  pfd.fd = fd;
+  pfd.events = events;
+  while(head != 0 && poll(&pfd, 1, 0) == 0)
+    gthread_yield();
+}
+
+// Like read(), but only this thread waits for input.
+int
+gthread_read(int fd, void *buf, int n)
+{
+  waitfd(fd, POLLIN);
+  return read(fd, buf, n);
+}
+
+// Like write(), but only this thread waits for room.
+int
+gthread_write(int fd, const void *buf, int n)
+{
+  waitfd(fd, POLLOUT);
+  return write(fd, buf, n);
+}
+
+// Run the threads until all have exited.
+void
+gthread_run(void)
+{
+  if(current == 0 && head != 0)
+    schedule(&runcontext);
+}
@@ -0,0 +1,249 @@
+// Trace a command: run it with the kernel's tracepoints on, and
+// write what they record to a file in the Trace Event Format that
+// chrome://tracing and Perfetto read.  System calls, log commits
+// and buffer cache misses appear in a row for each process; which
+// process each CPU ran, and disk completions, in a row for each CPU.
+//
+// usage: ktrace file command [args...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/memlayout.h"
+#include "kernel/syscall.h"
+#include "kernel/trace.h"
+#include "user/user.h"
+#include "user/sysnames.h"
+
+#define NREAD 64     // events per ktrace(TRACE_READ)
+
+struct traceev *ev;
+int nev, maxev;
+
+// Read what the kernel has recorded so far into ev[].
+void
+drain(void)
+{
+  struct traceev *bigger;
+  int n;
+
+  for(;;){
+    if(nev + NREAD > maxev){
+      maxev = maxev ? 2 * maxev : 4096;
+      if((bigger = malloc(maxev * sizeof(ev[0]))) == 0){
+        fprintf(2, "ktrace: out of memory\n");
+        exit(1);
+      }
+      memmove(bigger, ev, nev * sizeof(ev[0]));
+      free(ev);
+      ev = bigger;
+    }
+    if((n = ktrace(TRACE_READ, &ev[nev], NREAD)) <= 0)
+      break;
+    nev += n;
+  }
+}
+
+// Output to the file, a block at a time.
+int outfd;
+char outbuf[4096];
+int nout;
+
+void
+flush(void)
+{
+  if(nout > 0 && write(outfd, outbuf, nout) != nout){
+    fprintf(2, "ktrace: write failed\n");
+    exit(1);
+  }
+  nout = 0;
+}
+
+void
+emit(char *s)
+{
+  for(; *s; s++){
+    if(nout == sizeof(outbuf))
+      flush();
+    outbuf[nout++] = *s;
+  }
+}
+
+void
+emitnum(uint64 x)
+{
+  char buf[24];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = '\0';
+  do {
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  } while(x);
+  emit(buf + i);
+}
+
+void
+emitint(int x)
+{
+  if(x < 0){
+    emit("-");
+    x = -x;
+  }
+  emitnum(x);
+}
+
+// Start an event: its name, phase ("B" begin, "E" end, "i" instant),
+// time in microseconds, row, and the CPU it happened on.  Leaves
+// the args open for arg() and end().
+void
+event(char *name, char *ph, struct traceev *e, int pid, int tid)
+{
+  uint64 tpu = TIMEFREQ / 1000000;   // time counts per microsecond
+
+  emit(",\n{\"name\":\"");
+  emit(name);
+  emit("\",\"ph\":\"");
+  emit(ph);
+  emit("\",\"ts\":");
+  emitnum(e->time / tpu);
+  emit(".");
+  emitnum(e->time % tpu * 10 / tpu);
+  emit(",\"pid\":");
+  emitint(pid);
+  emit(",\"tid\":");
+  emitint(tid);
+  if(ph[0] == 'i')
+    emit(",\"s\":\"t\"");
+  emit(",\"args\":{\"cpu\":");
+  emitint(e->cpu);
+}
+
+void
+arg(char *name, int v)
+{
+  emit(",\"");
+  emit(name);
+  emit("\":");
+  emitint(v);
+}
+
+void
+end(void)
+{
+  emit("}}");
+}
+
+char*
+sysname(int num)
+{
+  if(num > 0 && num < sizeof(sysnames)/sizeof(sysnames[0]) && sysnames[num])
+    return sysnames[num];
+  return "?";
+}
+
+// Rows: pid 0 holds a row for each CPU, pid 1 a row for each process.
+void
+dump(void)
+{
+  struct traceev *e;
+
+  emit("{\"traceEvents\":[\n");
+  emit("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"cpus\"}},\n");
+  emit("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"processes\"}}");
+  for(e = ev; e < &ev[nev]; e++){
+    switch(e->type){
+    case TR_SYSCALL:
+      event(sysname(e->a), "B", e, 1, e->pid);
+      break;
+    case TR_SYSRET:
+      event(sysname(e->a), "E", e, 1, e->pid);
+      arg("ret", e->b);
+      break;
+    case TR_SWITCHIN:
+      event("run", "B", e, 0, e->cpu);
+      arg("pid", e->pid);
+      break;
+    case TR_SWITCHOUT:
+      event("run", "E", e, 0, e->cpu);
+      arg("state", e->a);
+      break;
+    case TR_BMISS:
+      event("bget miss", "i", e, 1, e->pid);
+      arg("block", e->a);
+      arg("dev", e->b);
+      break;
+    case TR_COMMIT:
+      event("commit", "B", e, 1, e->pid);
+      arg("blocks", e->a);
+      break;
+    case TR_COMMITTED:
+      event("commit", "E", e, 1, e->pid);
+      break;
+    case TR_DISKDONE:
+      event("disk done", "i", e, 0, e->cpu);
+      arg("block", e->a);
+      break;
+    default:
+      continue;
+    }
+    end();
+  }
+  emit("\n]}\n");
+  flush();
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct pollfd pfd;
+  int pid, p[2], lost;
+
+  if(argc < 3){
+    fprintf(2, "usage: ktrace file command [args...]\n");
+    exit(1);
+  }
+  if((outfd = open(argv[1], O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "ktrace: cannot create %s\n", argv[1]);
+    exit(1);
+  }
+
+  // the child holds the write side of p, so that the read side
+  // polls as hung up once the command exits.
+  if(pipe(p) < 0){
+    fprintf(2, "ktrace: pipe failed\n");
+    exit(1);
+  }
+  if(ktrace(TRACE_START, 0, 0) < 0){
+    fprintf(2, "ktrace: cannot start tracing\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "ktrace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(p[0]);
+    close(outfd);
+    exec(argv[2], argv + 2);
+    fprintf(2, "ktrace: exec %s failed\n", argv[2]);
+    exit(1);
+  }
+  close(p[1]);
+
+  // empty the kernel's rings every tick until the command exits.
+  pfd.fd = p[0];
+  pfd.events = 0;
+  do {
+    drain();
+  } while(poll(&pfd, 1, 1) == 0);
+  lost = ktrace(TRACE_STOP, 0, 0);
+  drain();
+  wait(0);
+
+  dump();
+  close(outfd);
+  printf("ktrace: %d events written to %s, %d lost\n", nev, argv[1], lost);
+  exit(0);
+}
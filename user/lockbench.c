@@ -0,0 +1,188 @@
+// Benchmark user-space locking between threads made by clone():
+// threads take turns incrementing a shared counter under a spin
+// lock, a futex-based mutex, and a lock made of a token passed
+// through a pipe; then two threads ping-pong with semaphores and
+// with pipes.
+//
+// usage: lockbench [threads [rounds]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define STACKSZ 4096
+#define WORK    50      // loop iterations outside the lock
+
+enum { SPIN, MUTEX, PIPE };
+
+int kind;
+int rounds;
+int counter;
+volatile int sink;
+int spinlk;
+struct mutex mu;
+int tokfd[2];
+struct sem ping, pong;
+int pingfd[2], pongfd[2];
+char *stack[NCPU];
+
+void
+lock(void)
+{
+  char c;
+
+  switch(kind){
+  case SPIN:
+    while(__sync_lock_test_and_set(&spinlk, 1) != 0)
+      ;
+    break;
+  case MUTEX:
+    mutex_lock(&mu);
+    break;
+  case PIPE:
+    read(tokfd[0], &c, 1);
+    break;
+  }
+}
+
+void
+unlock(void)
+{
+  switch(kind){
+  case SPIN:
+    __sync_lock_release(&spinlk);
+    break;
+  case MUTEX:
+    mutex_unlock(&mu);
+    break;
+  case PIPE:
+    write(tokfd[1], "t", 1);
+    break;
+  }
+}
+
+void
+incr(void *arg)
+{
+  int i, j;
+
+  for(i = 0; i < rounds; i++){
+    lock();
+    counter++;
+    unlock();
+    for(j = 0; j < WORK; j++)
+      sink = j;
+  }
+  exit(0);
+}
+
+// Run fn in nt threads and wait for them; return ms taken.
+int
+run(void (*fn)(void*), int nt)
+{
+  int tid[NCPU];
+  int i, t0;
+
+  t0 = millis();
+  for(i = 0; i < nt; i++){
+    if((tid[i] = clone(fn, (void*)(uint64)i, stack[i] + STACKSZ)) < 0){
+      fprintf(2, "lockbench: clone failed\n");
+      exit(1);
+    }
+  }
+  for(i = 0; i < nt; i++){
+    if(join(tid[i], 0) != tid[i]){
+      fprintf(2, "lockbench: join failed\n");
+      exit(1);
+    }
+  }
+  return millis() - t0;
+}
+
+void
+timelock(char *what, int k, int nt)
+{
+  int t;
+
+  kind = k;
+  counter = 0;
+  t = run(incr, nt);
+  if(counter != nt * rounds){
+    fprintf(2, "lockbench: %s: counter is %d, not %d\n", what, counter, nt * rounds);
+    exit(1);
+  }
+  printf("%s: %d threads, %d increments, %d ms\n", what, nt, counter, t);
+}
+
+// Thread 0 pings and thread 1 pongs, rounds times.
+void
+pingpong(void *arg)
+{
+  char c;
+  int i;
+
+  for(i = 0; i < rounds; i++){
+    if(kind == MUTEX){
+      if(arg == 0){
+        sem_post(&ping);
+        sem_wait(&pong);
+      } else {
+        sem_wait(&ping);
+        sem_post(&pong);
+      }
+    } else {
+      if(arg == 0){
+        write(pingfd[1], "p", 1);
+        read(pongfd[0], &c, 1);
+      } else {
+        read(pingfd[0], &c, 1);
+        write(pongfd[1], "p", 1);
+      }
+    }
+  }
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nt, i, t;
+
+  nt = 4;
+  rounds = 10000;
+  if(argc > 1)
+    nt = atoi(argv[1]);
+  if(argc > 2)
+    rounds = atoi(argv[2]);
+  if(nt < 1 || nt > NCPU || rounds < 1){
+    fprintf(2, "usage: lockbench [threads, at most %d [rounds]]\n", NCPU);
+    exit(1);
+  }
+  for(i = 0; i < NCPU; i++){
+    if((stack[i] = malloc(STACKSZ)) == 0){
+      fprintf(2, "lockbench: malloc failed\n");
+      exit(1);
+    }
+  }
+  mutex_init(&mu);
+  if(pipe(tokfd) < 0 || pipe(pingfd) < 0 || pipe(pongfd) < 0){
+    fprintf(2, "lockbench: pipe failed\n");
+    exit(1);
+  }
+  write(tokfd[1], "t", 1);
+
+  timelock("spin lock", SPIN, nt);
+  timelock("futex mutex", MUTEX, nt);
+  timelock("pipe token", PIPE, nt);
+
+  sem_init(&ping, 0);
+  sem_init(&pong, 0);
+  kind = MUTEX;
+  t = run(pingpong, 2);
+  printf("semaphore ping-pong: %d round trips, %d ms\n", rounds, t);
+  kind = PIPE;
+  t = run(pingpong, 2);
+  printf("pipe ping-pong: %d round trips, %d ms\n", rounds, t);
+  exit(0);
+}
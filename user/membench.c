@@ -0,0 +1,188 @@
+// Microbenchmark for the ulib memory and string functions.
+// Checks memset, memmove, memcmp and strlen against simple byte
+// loops for a range of sizes and alignments, then times both
+// versions and reports throughput.
+//
+// usage: membench [MB per measurement]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define MAXSZ 4096
+
+char src[MAXSZ+64];
+char dst[MAXSZ+64];
+
+int sizes[] = { 16, 256, 4096, 0 };
+
+// results go here so the compiler can't discard the calls.
+volatile int sink;
+
+// Byte-at-a-time versions, as ulib used to be.
+
+void*
+bytememset(void *d, int c, uint n)
+{
+  char *p = d;
+  while(n-- > 0)
+    *p++ = c;
+  return d;
+}
+
+void*
+bytememmove(void *d, const void *s, int n)
+{
+  char *dp = d;
+  const char *sp = s;
+  if(sp > dp){
+    while(n-- > 0)
+      *dp++ = *sp++;
+  } else {
+    dp += n;
+    sp += n;
+    while(n-- > 0)
+      *--dp = *--sp;
+  }
+  return d;
+}
+
+int
+bytememcmp(const void *a, const void *b, uint n)
+{
+  const char *p = a, *q = b;
+  while(n-- > 0){
+    if(*p != *q)
+      return *p - *q;
+    p++, q++;
+  }
+  return 0;
+}
+
+uint
+bytestrlen(const char *s)
+{
+  int n;
+  for(n = 0; s[n]; n++)
+    ;
+  return n;
+}
+
+int
+sign(int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+void
+fail(char *what, int size, int soff, int doff)
+{
+  printf("membench: %s wrong for size %d, offsets %d %d\n", what, size, soff, doff);
+  exit(1);
+}
+
+// Compare the word-at-a-time functions with the byte loops
+// for every combination of small offsets.
+void
+check(void)
+{
+  static char ref[MAXSZ+64];
+  int i, n, so, d;
+
+  for(n = 0; n < 100; n += 7){
+    for(so = 0; so < 9; so++){
+      for(d = 0; d < 9; d++){
+        for(i = 0; i < sizeof(src); i++){
+          src[i] = 'a' + i % 23;
+          dst[i] = ref[i] = 'A' + i % 19;
+        }
+        memset(dst+d, 'x', n);
+        bytememset(ref+d, 'x', n);
+        if(memcmp(dst, ref, sizeof(dst)) != 0)
+          fail("memset", n, so, d);
+        memmove(dst+d, src+so, n);
+        bytememmove(ref+d, src+so, n);
+        if(bytememcmp(dst, ref, sizeof(dst)) != 0)
+          fail("memmove", n, so, d);
+        memmove(dst+d, dst+so, n);  // overlapping
+        bytememmove(ref+d, ref+so, n);
+        if(bytememcmp(dst, ref, sizeof(dst)) != 0)
+          fail("overlapping memmove", n, so, d);
+        memmove(dst+d, src+so, n);
+        if(n > 0)
+          dst[d + n/2] ^= 1;
+        if(sign(memcmp(dst+d, src+so, n)) != sign(bytememcmp(dst+d, src+so, n)))
+          fail("memcmp", n, so, d);
+        src[so+n] = 0;
+        if(strlen(src+so) != bytestrlen(src+so))
+          fail("strlen", n, so, d);
+      }
+    }
+  }
+}
+
+// Time n calls of op on size bytes; return ms taken.
+int
+timeop(int op, int lib, int size, int off, int n)
+{
+  int i, t0;
+
+  memset(src, 'a', sizeof(src));
+  src[off+size-1] = 0;
+  memmove(dst, src, sizeof(dst));
+  t0 = millis();
+  for(i = 0; i < n; i++){
+    switch(op){
+    case 0:
+      if(lib) memset(dst+off, i, size); else bytememset(dst+off, i, size);
+      break;
+    case 1:
+      if(lib) memmove(dst+off, src, size); else bytememmove(dst+off, src, size);
+      break;
+    case 2:
+      if(lib) sink += memcmp(dst+off, src+off, size); else sink += bytememcmp(dst+off, src+off, size);
+      break;
+    case 3:
+      if(lib) sink += strlen(src+off); else sink += bytestrlen(src+off);
+      break;
+    }
+  }
+  return millis() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static char *ops[] = { "memset", "memmove", "memcmp", "strlen" };
+  int mb, op, s, off, n, tlib, tbyte;
+
+  mb = 16;
+  if(argc > 1)
+    mb = atoi(argv[1]);
+  if(mb < 1)
+    mb = 1;
+
+  check();
+  printf("membench: results match byte loops; %d MB per measurement\n", mb);
+
+  for(op = 0; op < 4; op++){
+    for(s = 0; sizes[s]; s++){
+      // off 0: everything aligned; off 1: destination misaligned
+      // (memmove) or source misaligned (strlen).
+      for(off = 0; off < 2; off++){
+        n = mb * 1024 * 1024 / sizes[s];
+        tlib = timeop(op, 1, sizes[s], off, n);
+        tbyte = timeop(op, 0, sizes[s], off, n);
+        if(tlib == 0)
+          tlib = 1;
+        if(tbyte == 0)
+          tbyte = 1;
+        printf("%s %d%s: %d MB/s, byte loop %d MB/s, %d.%dx\n",
+               ops[op], sizes[s], off ? " misaligned" : "",
+               mb * 1000 / tlib, mb * 1000 / tbyte,
+               tbyte / tlib, (tbyte * 10 / tlib) % 10);
+      }
+    }
+  }
+  exit(0);
+}
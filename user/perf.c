@@ -0,0 +1,67 @@
+// Count hardware events for a command, like perf stat: run it,
+// wait for it, and print what getrusage(RUSAGE_CHILDREN) says it
+// and the children it waited for used.  qemu counts cycles,
+// instructions and TLB misses, but does not model caches.
+//
+// usage: perf command [args...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/memlayout.h"
+#include "kernel/rusage.h"
+#include "user/user.h"
+
+char *hpmnames[NHPM] = {
+  [HPM_CYCLE]   "cycles",
+  [HPM_INSTRET] "instructions",
+  [HPM_DTLBLD]  "dTLB-load-misses",
+  [HPM_DTLBST]  "dTLB-store-misses",
+  [HPM_ITLB]    "iTLB-misses",
+};
+
+int
+main(int argc, char *argv[])
+{
+  struct rusage before, after;
+  uint64 t0, t, d, ins;
+  int pid, i, xstatus;
+
+  if(argc < 2){
+    fprintf(2, "usage: perf command [args...]\n");
+    exit(1);
+  }
+  if(getrusage(RUSAGE_CHILDREN, &before) < 0){
+    fprintf(2, "perf: getrusage failed\n");
+    exit(1);
+  }
+  t0 = rdtime();
+  if((pid = fork()) < 0){
+    fprintf(2, "perf: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "perf: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  wait(&xstatus);
+  t = rdtime() - t0;
+  getrusage(RUSAGE_CHILDREN, &after);
+
+  printf("\nperf: counts for %s (exit status %d):\n", argv[1], xstatus);
+  ins = after.hpm[HPM_INSTRET] - before.hpm[HPM_INSTRET];
+  for(i = 0; i < NHPM; i++){
+    d = after.hpm[i] - before.hpm[i];
+    printf("  %l\t%s", d, hpmnames[i]);
+    if(i == HPM_INSTRET && after.hpm[HPM_CYCLE] > before.hpm[HPM_CYCLE])
+      printf("\t(%l per 100 cycles)", d * 100 / (after.hpm[HPM_CYCLE] - before.hpm[HPM_CYCLE]));
+    else if(i != HPM_CYCLE && ins > 0)
+      printf("\t(%l per million instructions)", d * 1000000 / ins);
+    printf("\n");
+  }
+  printf("  %l ms user, %l ms sys, %l ms elapsed\n",
+         (after.utime - before.utime) / (TIMEFREQ / 1000),
+         (after.stime - before.stime) / (TIMEFREQ / 1000),
+         t / (TIMEFREQ / 1000));
+  exit(0);
+}
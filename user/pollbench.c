@@ -0,0 +1,137 @@
+// Benchmark one process servicing many pipe clients with poll(),
+// against forking one blocking reader per client pipe.  Each
+// client writes a stream of small messages to its own pipe.
+//
+// usage: pollbench [messages]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define NCLIENT 10      // the server also needs fds 0-2 (NOFILE is 16)
+#define MSGSZ   32
+
+int nmsg;
+
+// Fork NCLIENT clients, each writing nmsg messages to its own
+// pipe; store the read ends in fd[].
+void
+clients(int *fd)
+{
+  char msg[MSGSZ];
+  int i, j, p[2];
+
+  memset(msg, 'm', sizeof(msg));
+  for(i = 0; i < NCLIENT; i++){
+    if(pipe(p) < 0){
+      fprintf(2, "pollbench: pipe failed\n");
+      exit(1);
+    }
+    if(fork() == 0){
+      close(p[0]);
+      for(j = 0; j < i; j++)
+        close(fd[j]);
+      for(j = 0; j < nmsg; j++)
+        write(p[1], msg, sizeof(msg));
+      exit(0);
+    }
+    close(p[1]);
+    fd[i] = p[0];
+  }
+}
+
+// Read all the clients' messages in this process with poll().
+int
+pollserver(void)
+{
+  struct pollfd pfd[NCLIENT];
+  int fd[NCLIENT], i, n, nopen, t0, tot;
+  char buf[512];
+
+  t0 = millis();
+  clients(fd);
+  for(i = 0; i < NCLIENT; i++){
+    pfd[i].fd = fd[i];
+    pfd[i].events = POLLIN;
+  }
+  tot = 0;
+  nopen = NCLIENT;
+  while(nopen > 0){
+    if(poll(pfd, NCLIENT, -1) <= 0){
+      fprintf(2, "pollbench: poll failed\n");
+      exit(1);
+    }
+    for(i = 0; i < NCLIENT; i++){
+      if(pfd[i].revents == 0)
+        continue;
+      if((n = read(pfd[i].fd, buf, sizeof(buf))) > 0){
+        tot += n;
+      } else {
+        close(pfd[i].fd);
+        pfd[i].fd = -1;
+        nopen--;
+      }
+    }
+  }
+  for(i = 0; i < NCLIENT; i++)
+    wait(0);
+  if(tot != NCLIENT * nmsg * MSGSZ){
+    fprintf(2, "pollbench: poll server read %d bytes\n", tot);
+    exit(1);
+  }
+  return millis() - t0;
+}
+
+// Read each client's messages in a reader process of its own.
+int
+forkserver(void)
+{
+  int fd[NCLIENT], i, j, n, t0, tot, xstatus, ok;
+  char buf[512];
+
+  t0 = millis();
+  clients(fd);
+  for(i = 0; i < NCLIENT; i++){
+    if(fork() == 0){
+      for(j = 0; j < NCLIENT; j++)
+        if(j != i)
+          close(fd[j]);
+      tot = 0;
+      while((n = read(fd[i], buf, sizeof(buf))) > 0)
+        tot += n;
+      exit(tot == nmsg * MSGSZ ? 0 : 1);
+    }
+  }
+  for(i = 0; i < NCLIENT; i++)
+    close(fd[i]);
+  ok = 1;
+  for(i = 0; i < 2 * NCLIENT; i++){
+    wait(&xstatus);
+    if(xstatus != 0)
+      ok = 0;
+  }
+  if(!ok){
+    fprintf(2, "pollbench: a reader lost messages\n");
+    exit(1);
+  }
+  return millis() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int t;
+
+  nmsg = 2000;
+  if(argc > 1)
+    nmsg = atoi(argv[1]);
+  if(nmsg < 1)
+    nmsg = 1;
+
+  t = pollserver();
+  printf("poll, one server: %d clients x %d messages, %d ms\n", NCLIENT, nmsg, t);
+  t = forkserver();
+  printf("one reader per client: %d clients x %d messages, %d ms\n", NCLIENT, nmsg, t);
+  exit(0);
+}
@@ -0,0 +1,303 @@
+// Profile a command: run it with the kernel's sampling profiler
+// on, then say which functions the samples fell in, both where
+// each was interrupted ("self") and anywhere in its chain of
+// callers ("total").  Functions are named from kernel.sym and
+// the command's own .sym file, which the Makefile puts on the
+// disk; kernel functions are marked [k].  Samples of other
+// processes in user space, which could be running anything,
+// are only counted.
+//
+// usage: prof command [args...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/prof.h"
+#include "user/user.h"
+
+#define NREAD 64     // samples per prof(PROF_READ)
+#define NTOP  20     // functions to list
+
+struct sym {
+  uint64 addr;
+  char *name;
+  int kernel;
+  int self;
+  int total;
+};
+
+struct symtab {
+  struct sym *sym;
+  int n;
+};
+
+struct symtab ktab, utab;
+struct profsample samples[NREAD];
+int nsample, nuser, nkernel, nother;
+
+int
+hexval(char c)
+{
+  if(c >= '0' && c <= '9')
+    return c - '0';
+  if(c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// Is name that of a function?  The symbol tables also hold
+// sections, files, and local labels.
+int
+isfunc(char *name)
+{
+  int n = strlen(name);
+
+  if(n == 0 || name[0] == '.' || name[0] == '$')
+    return 0;
+  if(n > 2 && name[n-2] == '.' && strchr("cSo", name[n-1]))
+    return 0;
+  return 1;
+}
+
+// Sort t by address, with a shell sort.
+void
+sortsyms(struct symtab *t)
+{
+  int gap, i, j;
+  struct sym s;
+
+  for(gap = t->n / 2; gap > 0; gap /= 2){
+    for(i = gap; i < t->n; i++){
+      s = t->sym[i];
+      for(j = i; j >= gap && t->sym[j-gap].addr > s.addr; j -= gap)
+        t->sym[j] = t->sym[j-gap];
+      t->sym[j] = s;
+    }
+  }
+}
+
+// Load a symbol table made by objdump -t and sed in the
+// Makefile: lines of a hex address, a space, and a name.
+// A missing file leaves t empty.
+void
+loadsyms(struct symtab *t, char *file, int kernel)
+{
+  struct stat st;
+  char *buf, *p, *e, *name;
+  uint64 addr;
+  int fd, n, v;
+
+  if((fd = open(file, O_RDONLY)) < 0){
+    fprintf(2, "prof: no symbols in %s\n", file);
+    return;
+  }
+  if(fstat(fd, &st) < 0 || (buf = malloc(st.size + 1)) == 0){
+    fprintf(2, "prof: cannot load %s\n", file);
+    exit(1);
+  }
+  n = read(fd, buf, st.size);
+  close(fd);
+  if(n < 0)
+    n = 0;
+  buf[n] = '\0';
+
+  // a line holds at most one symbol; allocate for every line.
+  t->n = 0;
+  for(p = buf, n = 1; *p; p++)
+    if(*p == '\n')
+      n++;
+  if((t->sym = malloc(n * sizeof(struct sym))) == 0){
+    fprintf(2, "prof: out of memory\n");
+    exit(1);
+  }
+
+  for(p = buf; *p; p = e){
+    if((e = strchr(p, '\n')) != 0)
+      *e++ = '\0';
+    else
+      e = p + strlen(p);
+    addr = 0;
+    while((v = hexval(*p)) >= 0){
+      addr = addr * 16 + v;
+      p++;
+    }
+    if(*p != ' ')
+      continue;
+    name = p + 1;
+    if(!isfunc(name))
+      continue;
+    t->sym[t->n].addr = addr;
+    t->sym[t->n].name = name;
+    t->sym[t->n].kernel = kernel;
+    t->sym[t->n].self = 0;
+    t->sym[t->n].total = 0;
+    t->n++;
+  }
+  sortsyms(t);
+}
+
+// The function containing pc: the last symbol at or below it.
+struct sym*
+lookup(struct symtab *t, uint64 pc)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = t->n;
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(t->sym[mid].addr <= pc)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if(lo == 0)
+    return 0;
+  return &t->sym[lo-1];
+}
+
+void
+count(struct profsample *s, int pid)
+{
+  struct symtab *t;
+  struct sym *f[PROFDEPTH];
+  int i, j;
+
+  nsample++;
+  if(s->user && s->pid != pid){
+    nother++;
+    return;
+  }
+  if(s->user){
+    nuser++;
+    t = &utab;
+  } else {
+    nkernel++;
+    t = &ktab;
+  }
+  for(i = 0; i < PROFDEPTH && s->pc[i]; i++){
+    // a return address may be just past the end of its
+    // caller, so look up the call instruction instead.
+    f[i] = lookup(t, i == 0 ? s->pc[i] : s->pc[i] - 4);
+    if(f[i] == 0)
+      continue;
+    if(i == 0)
+      f[i]->self++;
+    // count recursion once.
+    for(j = 0; j < i; j++)
+      if(f[j] == f[i])
+        break;
+    if(j == i)
+      f[i]->total++;
+  }
+}
+
+void
+drain(int pid)
+{
+  int i, n;
+
+  while((n = prof(PROF_READ, samples, NREAD)) > 0)
+    for(i = 0; i < n; i++)
+      count(&samples[i], pid);
+}
+
+// Print the NTOP functions with the largest self, or total, counts.
+void
+top(char *what, int total)
+{
+  struct symtab *tabs[2] = { &ktab, &utab };
+  struct sym *best, *s;
+  int i, j, k, c, bc;
+
+  printf("%s:\n", what);
+  for(i = 0; i < NTOP; i++){
+    best = 0;
+    bc = 0;
+    for(k = 0; k < 2; k++){
+      for(j = 0; j < tabs[k]->n; j++){
+        s = &tabs[k]->sym[j];
+        c = total ? s->total : s->self;
+        if(c > bc){
+          best = s;
+          bc = c;
+        }
+      }
+    }
+    if(best == 0)
+      break;
+    printf("  %d\t%d%%\t%s%s\n", bc, bc * 100 / nsample, best->name,
+           best->kernel ? " [k]" : "");
+    // take it out of the running.
+    if(total)
+      best->total = -best->total;
+    else
+      best->self = -best->self;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct pollfd pfd;
+  char file[64], *prog, *q;
+  int pid, p[2], dropped;
+
+  if(argc < 2){
+    fprintf(2, "usage: prof command [args...]\n");
+    exit(1);
+  }
+  prog = argv[1];
+  for(q = argv[1]; *q; q++)
+    if(*q == '/')
+      prog = q + 1;
+  if(strlen(prog) + 6 > sizeof(file)){
+    fprintf(2, "prof: name too long\n");
+    exit(1);
+  }
+  strcpy(file, "/");
+  strcpy(file + 1, prog);
+  strcpy(file + 1 + strlen(prog), ".sym");
+  loadsyms(&ktab, "/kernel.sym", 1);
+  loadsyms(&utab, file, 0);
+
+  // the child holds the write side of p, so that the read side
+  // polls as hung up once the command exits.
+  if(pipe(p) < 0){
+    fprintf(2, "prof: pipe failed\n");
+    exit(1);
+  }
+  if(prof(PROF_START, 0, 0) < 0){
+    fprintf(2, "prof: cannot start profiling\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "prof: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(p[0]);
+    exec(argv[1], argv + 1);
+    fprintf(2, "prof: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  close(p[1]);
+
+  // empty the kernel's rings every tick until the command exits.
+  pfd.fd = p[0];
+  pfd.events = 0;
+  do {
+    drain(pid);
+  } while(poll(&pfd, 1, 1) == 0);
+  dropped = prof(PROF_STOP, 0, 0);
+  drain(pid);
+  wait(0);
+
+  printf("prof: %d samples: %d in %s, %d in the kernel, %d in other processes; %d dropped\n",
+         nsample, nuser, prog, nkernel, nother, dropped);
+  if(nsample == 0)
+    exit(0);
+  top("self", 0);
+  top("total", 1);
+  exit(0);
+}
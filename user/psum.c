@@ -0,0 +1,100 @@
+// Benchmark summing a large array with 1, 2, 4, ... threads made
+// by clone(), each summing its own slice of the shared array, to
+// see how the work scales across CPUs.
+//
+// usage: psum [passes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define N       (1024*1024)   // ints in the array
+#define STACKSZ 4096
+
+struct slice {
+  int lo;
+  int hi;
+  uint64 sum;
+};
+
+int *a;
+int passes;
+struct slice slice[NCPU];
+
+void
+sum(void *arg)
+{
+  struct slice *s = arg;
+  uint64 t;
+  int i, j;
+
+  t = 0;
+  for(j = 0; j < passes; j++)
+    for(i = s->lo; i < s->hi; i++)
+      t += a[i];
+  s->sum = t;
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *stack[NCPU];
+  int tid[NCPU];
+  int i, nt, t0, t, t1, status;
+  uint64 total, want;
+
+  passes = 10;
+  if(argc > 1)
+    passes = atoi(argv[1]);
+  if(passes < 1)
+    passes = 1;
+
+  if((a = (int*)sbrk(N * sizeof(int))) == (int*)-1){
+    fprintf(2, "psum: sbrk failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++)
+    a[i] = i;
+  want = (uint64)passes * ((uint64)N * (N - 1) / 2);
+  for(i = 0; i < NCPU; i++){
+    if((stack[i] = malloc(STACKSZ)) == 0){
+      fprintf(2, "psum: malloc failed\n");
+      exit(1);
+    }
+  }
+
+  t1 = 0;
+  for(nt = 1; nt <= NCPU; nt *= 2){
+    t0 = millis();
+    for(i = 0; i < nt; i++){
+      slice[i].lo = (uint64)N * i / nt;
+      slice[i].hi = (uint64)N * (i + 1) / nt;
+      if((tid[i] = clone(sum, &slice[i], stack[i] + STACKSZ)) < 0){
+        fprintf(2, "psum: clone failed\n");
+        exit(1);
+      }
+    }
+    total = 0;
+    for(i = 0; i < nt; i++){
+      if(join(tid[i], &status) != tid[i] || status != 0){
+        fprintf(2, "psum: join failed\n");
+        exit(1);
+      }
+      total += slice[i].sum;
+    }
+    t = millis() - t0;
+    if(total != want){
+      fprintf(2, "psum: wrong sum with %d threads\n", nt);
+      exit(1);
+    }
+    if(t == 0)
+      t = 1;
+    if(t1 == 0)
+      t1 = t;
+    printf("%d threads: %d passes over %d ints, %d ms, speedup %d.%d\n",
+           nt, passes, N, t, t1 / t, t1 * 10 / t % 10);
+  }
+  exit(0);
+}
@@ -0,0 +1,180 @@
+// Benchmark record-oriented I/O.  Writes a file of records, each a
+// small header followed by a payload, first with one write() per
+// piece, then with one writev() per record, then with one writev()
+// per batch of records.  Then has several processes read records at
+// random offsets from one shared descriptor with pread().
+//
+// usage: recbench [passes]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define FILE    "recbench.dat"
+#define NREC    4000    // records per file; must fit in MAXFILE blocks
+#define PAYLOAD 56      // payload bytes per record
+#define BATCH   (MAXIOV/2)  // records per writev() in the batched case
+#define NREADER 4       // processes reading with pread()
+#define NREAD   2000    // records read by each of them
+
+struct hdr {
+  int seq;
+  int len;
+};
+
+#define RECSZ   ((int)sizeof(struct hdr) + PAYLOAD)
+
+struct hdr hdrs[BATCH];
+char payload[PAYLOAD];
+
+void
+writerecs(int fd, int mode)
+{
+  struct iovec iov[2*BATCH];
+  int i, j, n, want;
+
+  for(i = 0; i < NREC; i += n){
+    n = (mode == 2 ? BATCH : 1);
+    if(i + n > NREC)
+      n = NREC - i;
+    for(j = 0; j < n; j++){
+      hdrs[j].seq = i + j;
+      hdrs[j].len = PAYLOAD;
+      iov[2*j].iov_base = &hdrs[j];
+      iov[2*j].iov_len = sizeof(struct hdr);
+      iov[2*j+1].iov_base = payload;
+      iov[2*j+1].iov_len = PAYLOAD;
+    }
+    want = n * RECSZ;
+    if(mode == 0){
+      if(write(fd, &hdrs[0], sizeof(struct hdr)) != sizeof(struct hdr) ||
+         write(fd, payload, PAYLOAD) != PAYLOAD)
+        want = -1;
+    } else if(writev(fd, iov, 2*n) != want){
+      want = -1;
+    }
+    if(want < 0){
+      fprintf(2, "recbench: write of record %d failed\n", i);
+      exit(1);
+    }
+  }
+}
+
+// Check that the file holds the records in order.
+void
+verify(void)
+{
+  struct hdr h;
+  char buf[PAYLOAD];
+  int fd, i;
+
+  if((fd = open(FILE, O_RDONLY)) < 0){
+    fprintf(2, "recbench: cannot open %s\n", FILE);
+    exit(1);
+  }
+  for(i = 0; i < NREC; i++){
+    if(read(fd, &h, sizeof(h)) != sizeof(h) || read(fd, buf, PAYLOAD) != PAYLOAD ||
+       h.seq != i || h.len != PAYLOAD || memcmp(buf, payload, PAYLOAD) != 0){
+      fprintf(2, "recbench: record %d is wrong\n", i);
+      exit(1);
+    }
+  }
+  close(fd);
+}
+
+void
+timewrite(int mode, int passes)
+{
+  static char *names[] = { "write", "writev", "writev batch" };
+  int i, fd, t0, t;
+
+  t0 = millis();
+  for(i = 0; i < passes; i++){
+    if((fd = open(FILE, O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+      fprintf(2, "recbench: cannot create %s\n", FILE);
+      exit(1);
+    }
+    writerecs(fd, mode);
+    close(fd);
+  }
+  t = millis() - t0;
+  verify();
+  if(t == 0)
+    t = 1;
+  printf("%s: %d records, %d ms, %d records/s, %d KB/s\n",
+         names[mode], NREC * passes, t, (int)((uint64)NREC * passes * 1000 / t),
+         (int)((uint64)NREC * passes * RECSZ / 1024 * 1000 / t));
+}
+
+// Random record numbers, so that the readers don't read in step.
+uint
+rnd(uint *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7fff;
+}
+
+void
+timepread(void)
+{
+  struct hdr h;
+  int fd, i, k, t0, t, xstatus, bad;
+  uint seed, r;
+
+  if((fd = open(FILE, O_RDONLY)) < 0){
+    fprintf(2, "recbench: cannot open %s\n", FILE);
+    exit(1);
+  }
+  t0 = millis();
+  for(k = 0; k < NREADER; k++){
+    if(fork() == 0){
+      seed = k + 1;
+      for(i = 0; i < NREAD; i++){
+        r = rnd(&seed) % NREC;
+        if(pread(fd, &h, sizeof(h), r * RECSZ) != sizeof(h) || h.seq != r){
+          fprintf(2, "recbench: pread of record %d failed\n", r);
+          exit(1);
+        }
+      }
+      exit(0);
+    }
+  }
+  bad = 0;
+  for(k = 0; k < NREADER; k++){
+    wait(&xstatus);
+    if(xstatus != 0)
+      bad = 1;
+  }
+  t = millis() - t0;
+  close(fd);
+  if(bad)
+    exit(1);
+  if(t == 0)
+    t = 1;
+  printf("pread: %d processes, %d records, %d ms, %d records/s\n",
+         NREADER, NREADER * NREAD, t, NREADER * NREAD * 1000 / t);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int passes, i, mode;
+
+  passes = 2;
+  if(argc > 1)
+    passes = atoi(argv[1]);
+  if(passes < 1)
+    passes = 1;
+
+  for(i = 0; i < PAYLOAD; i++)
+    payload[i] = 'a' + i % 26;
+  printf("recbench: %d records of %d bytes, %d passes\n", NREC, RECSZ, passes);
+  for(mode = 0; mode < 3; mode++)
+    timewrite(mode, passes);
+  timepread();
+
+  unlink(FILE);
+  exit(0);
+}
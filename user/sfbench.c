@@ -0,0 +1,80 @@
+// Benchmark a burst of small-file operations: create, write and
+// remove many small files, first leaving it to the file system
+// when to commit, then calling fsync() after every file.
+//
+// usage: sfbench [files]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define FILESZ  200
+
+char data[FILESZ];
+
+// Create, write and remove nfile files; return ms taken.
+int
+burst(int nfile, int sync)
+{
+  char name[8];
+  int i, fd, t0;
+
+  name[0] = 's';
+  name[1] = 'f';
+  name[5] = '\0';
+  t0 = millis();
+  for(i = 0; i < nfile; i++){
+    name[2] = '0' + i / 100 % 10;
+    name[3] = '0' + i / 10 % 10;
+    name[4] = '0' + i % 10;
+    if((fd = open(name, O_CREATE|O_WRONLY)) < 0){
+      fprintf(2, "sfbench: cannot create %s\n", name);
+      exit(1);
+    }
+    if(write(fd, data, FILESZ) != FILESZ){
+      fprintf(2, "sfbench: write %s failed\n", name);
+      exit(1);
+    }
+    if(sync && fsync(fd) < 0){
+      fprintf(2, "sfbench: fsync %s failed\n", name);
+      exit(1);
+    }
+    close(fd);
+  }
+  for(i = 0; i < nfile; i++){
+    name[2] = '0' + i / 100 % 10;
+    name[3] = '0' + i / 10 % 10;
+    name[4] = '0' + i % 10;
+    if(unlink(name) < 0){
+      fprintf(2, "sfbench: cannot remove %s\n", name);
+      exit(1);
+    }
+  }
+  return millis() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nfile, sync, t;
+
+  nfile = 50;
+  if(argc > 1)
+    nfile = atoi(argv[1]);
+  if(nfile < 1 || nfile > 100){
+    // mkfs makes room for only NINODES inodes.
+    fprintf(2, "usage: sfbench [files, at most 100]\n");
+    exit(1);
+  }
+
+  memset(data, 'x', sizeof(data));
+  for(sync = 0; sync < 2; sync++){
+    t = burst(nfile, sync);
+    if(t == 0)
+      t = 1;
+    printf("%s: %d files created, written and removed, %d ms, %d files/s\n",
+           sync ? "fsync each" : "no fsync", nfile, t, nfile * 1000 / t);
+  }
+  exit(0);
+}
@@ -0,0 +1,71 @@
+// Benchmark sleeping: how long usleep() of less than a tick
+// really takes, and how much a busy loop slows down when many
+// other processes are asleep, which used to mean they were all
+// woken at every tick to look at the clock.
+//
+// usage: sleepbench [sleepers]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define NUSLEEP 100     // usleep()s of each length
+#define LOOPS   (200*1000*1000)
+
+volatile int sink;
+
+// Spin for a fixed amount of work; return ms taken.
+int
+spin(void)
+{
+  int i, t0;
+
+  t0 = millis();
+  for(i = 0; i < LOOPS; i++)
+    sink = i;
+  return millis() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int us[] = { 100, 1000, 10000 };
+  int nsleeper, i, j, t0, t, pid[50];
+
+  nsleeper = 40;
+  if(argc > 1)
+    nsleeper = atoi(argv[1]);
+  if(nsleeper < 0 || nsleeper > 50){
+    fprintf(2, "usage: sleepbench [sleepers, at most 50]\n");
+    exit(1);
+  }
+
+  for(i = 0; i < sizeof(us)/sizeof(us[0]); i++){
+    t0 = millis();
+    for(j = 0; j < NUSLEEP; j++)
+      usleep(us[i]);
+    t = millis() - t0;
+    printf("%d x usleep(%d): %d ms, %d wanted\n",
+           NUSLEEP, us[i], t, NUSLEEP * us[i] / 1000);
+  }
+
+  t = spin();
+  printf("busy loop alone: %d ms\n", t);
+  for(i = 0; i < nsleeper; i++){
+    if((pid[i] = fork()) < 0){
+      fprintf(2, "sleepbench: fork failed\n");
+      exit(1);
+    }
+    if(pid[i] == 0){
+      sleep(1000000);
+      exit(0);
+    }
+  }
+  t = spin();
+  printf("busy loop with %d sleepers: %d ms\n", nsleeper, t);
+  for(i = 0; i < nsleeper; i++){
+    kill(pid[i]);
+    wait(0);
+  }
+  exit(0);
+}
@@ -7,43 +7,63 @@
 //    for (i = 0; i < 40000; i++)
 //      asm volatile("");
 
+// Each run has NWORKER processes each write and then read back its
+// own file at once; bench() times the runs.
+
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fs.h"
 #include "kernel/fcntl.h"
 
-int
-main(int argc, char *argv[])
+#define NWORKER 5    // processes writing at once
+#define NBLOCK  20   // blocks each writes and reads
+
+void
+stress(int n)
 {
   int fd, i;
   char path[] = "stressfs0";
   char data[512];
 
-  printf("stressfs starting\n");
   memset(data, 'a', sizeof(data));
-
-  for(i = 0; i < 4; i++)
-    if(fork() > 0)
-      break;
-
-  printf("write %d\n", i);
-
-  path[8] += i;
+  path[8] += n;
   fd = open(path, O_CREATE | O_RDWR);
-  for(i = 0; i < 20; i++)
+  for(i = 0; i < NBLOCK; i++)
 //    printf(fd, "%d\n", i);
     write(fd, data, sizeof(data));
   close(fd);
 
-  printf("read\n");
-
   fd = open(path, O_RDONLY);
-  for (i = 0; i < 20; i++)
+  for (i = 0; i < NBLOCK; i++)
     read(fd, data, sizeof(data));
   close(fd);
+}
+
+void
+run(void)
+{
+  int i, pid;
 
-  wait(0);
+  for(i = 0; i < NWORKER; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("stressfs: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      stress(i);
+      exit(0);
+    }
+  }
+  for(i = 0; i < NWORKER; i++)
+    wait(0);
+}
 
+int
+main(int argc, char *argv[])
+{
+  printf("stressfs starting\n");
+  bench("stressfs", run, 1, 10, NWORKER * NBLOCK * 2);
   exit(0);
 }
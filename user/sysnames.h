@@ -0,0 +1,53 @@
+// Names of the system calls, by number, for tools that print
+// what the kernel records about them.
+
+static char *sysnames[] = {
+  [SYS_fork]         "fork",
+  [SYS_exit]         "exit",
+  [SYS_wait]         "wait",
+  [SYS_pipe]         "pipe",
+  [SYS_read]         "read",
+  [SYS_kill]         "kill",
+  [SYS_exec]         "exec",
+  [SYS_fstat]        "fstat",
+  [SYS_chdir]        "chdir",
+  [SYS_dup]          "dup",
+  [SYS_getpid]       "getpid",
+  [SYS_sbrk]         "sbrk",
+  [SYS_sleep]        "sleep",
+  [SYS_uptime]       "uptime",
+  [SYS_open]         "open",
+  [SYS_write]        "write",
+  [SYS_mknod]        "mknod",
+  [SYS_unlink]       "unlink",
+  [SYS_link]         "link",
+  [SYS_mkdir]        "mkdir",
+  [SYS_close]        "close",
+  [SYS_getdents]     "getdents",
+  [SYS_openat]       "openat",
+  [SYS_mkdirat]      "mkdirat",
+  [SYS_unlinkat]     "unlinkat",
+  [SYS_fstatat]      "fstatat",
+  [SYS_readv]        "readv",
+  [SYS_writev]       "writev",
+  [SYS_pread]        "pread",
+  [SYS_pwrite]       "pwrite",
+  [SYS_sendfile]     "sendfile",
+  [SYS_cachestat]    "cachestat",
+  [SYS_fsync]        "fsync",
+  [SYS_clone]        "clone",
+  [SYS_join]         "join",
+  [SYS_futex_wait]   "futex_wait",
+  [SYS_futex_wake]   "futex_wake",
+  [SYS_poll]         "poll",
+  [SYS_fcntl]        "fcntl",
+  [SYS_uring_setup]  "uring_setup",
+  [SYS_uring_enter]  "uring_enter",
+  [SYS_fallocate]    "fallocate",
+  [SYS_usleep]       "usleep",
+  [SYS_prof]         "prof",
+  [SYS_ktrace]       "ktrace",
+  [SYS_getrusage]    "getrusage",
+  [SYS_procinfo]     "procinfo",
+  [SYS_sysstat]      "sysstat",
+};
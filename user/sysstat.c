@@ -0,0 +1,96 @@
+// Count and time system calls: reset the kernel's statistics, run
+// a command, and print, for each system call it (and everything
+// else running meanwhile) made, how many calls there were and how
+// many clock cycles they took, with a histogram of latencies in
+// powers of two.  With no command, print the totals since the
+// last reset.
+//
+// usage: sysstat [command [args...]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/syscall.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+#include "user/sysnames.h"
+
+#define NSYS (sizeof(sysnames)/sizeof(sysnames[0]))
+
+struct sysstat st[NSYS];
+
+// The bucket holding the call that fraction f of the way
+// through s's calls, in order of latency.
+int
+percentile(struct sysstat *s, int f)
+{
+  uint64 n, want;
+  int b;
+
+  want = s->count * f / 100;
+  n = 0;
+  for(b = 0; b < NSYSHIST-1; b++){
+    n += s->hist[b];
+    if(n > want)
+      break;
+  }
+  return b;
+}
+
+void
+report(int n)
+{
+  struct sysstat *s;
+  int num, b;
+
+  printf("call\tcount\tmean\tp50<\tp99<\t(cycles)\n");
+  for(num = 1; num < n; num++){
+    s = &st[num];
+    if(s->count == 0)
+      continue;
+    printf("%s\t%l\t%l\t2^%d\t2^%d\n", sysnames[num] ? sysnames[num] : "?",
+           s->count, s->cycles / s->count,
+           percentile(s, 50) + 1, percentile(s, 99) + 1);
+  }
+
+  printf("\nlatency histograms, calls taking [2^k, 2^k+1) cycles:\n");
+  for(num = 1; num < n; num++){
+    s = &st[num];
+    if(s->count == 0)
+      continue;
+    printf("%s:", sysnames[num] ? sysnames[num] : "?");
+    for(b = 0; b < NSYSHIST; b++)
+      if(s->hist[b])
+        printf(" 2^%d:%d", b, s->hist[b]);
+    printf("\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, n;
+
+  if(argc > 1){
+    if(sysstat(SYSSTAT_RESET, 0, 0) < 0){
+      fprintf(2, "sysstat: cannot reset\n");
+      exit(1);
+    }
+    if((pid = fork()) < 0){
+      fprintf(2, "sysstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "sysstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+
+  if((n = sysstat(SYSSTAT_READ, st, NSYS)) < 0){
+    fprintf(2, "sysstat: cannot read statistics\n");
+    exit(1);
+  }
+  report(n);
+  exit(0);
+}
@@ -0,0 +1,113 @@
+// List processes and the resources they have used, from
+// procinfo().  With a count, list them that many times, a
+// second apart, each time with the share of a CPU each had
+// over the last second, busiest first.
+//
+// usage: top [rounds]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/memlayout.h"
+#include "kernel/rusage.h"
+#include "user/user.h"
+
+// in the order of enum procstate in proc.h.
+char *states[] = { "unused", "used", "sleep", "runble", "run", "zombie" };
+
+struct procinfo cur[NPROC], prev[NPROC];
+int ncur, nprev;
+int busy[NPROC];   // time each of cur[] ran in the last interval
+
+// Time CSR counts in milliseconds.
+int
+ms(uint64 t)
+{
+  return t / (TIMEFREQ / 1000);
+}
+
+// Fill in busy[] from the usage in prev[] of the same process.
+void
+delta(void)
+{
+  int i, j;
+  uint64 t;
+
+  for(i = 0; i < ncur; i++){
+    t = cur[i].ru.utime + cur[i].ru.stime;
+    for(j = 0; j < nprev; j++){
+      if(prev[j].pid == cur[i].pid){
+        t -= prev[j].ru.utime + prev[j].ru.stime;
+        break;
+      }
+    }
+    busy[i] = ms(t);
+  }
+}
+
+void
+show(struct procinfo *pi, int interval)
+{
+  char *state;
+
+  if(pi->state >= 0 && pi->state < sizeof(states)/sizeof(states[0]))
+    state = states[pi->state];
+  else
+    state = "?";
+  printf("%d\t%d\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t",
+         pi->pid, pi->ppid, state, pi->nthread, (int)(pi->sz / 1024),
+         ms(pi->ru.utime), ms(pi->ru.stime), pi->ru.nvcsw, pi->ru.nivcsw,
+         pi->ru.inblock, pi->ru.oublock);
+  if(interval > 0)
+    printf("%d%%\t", busy[pi - cur] * 100 / interval);
+  printf("%s\n", pi->name);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds, r, i, j, best, t0, interval;
+
+  rounds = 1;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(rounds < 1){
+    fprintf(2, "usage: top [rounds]\n");
+    exit(1);
+  }
+
+  interval = 0;
+  t0 = millis();
+  for(r = 0; r < rounds; r++){
+    if(r > 0){
+      sleep(10);
+      memmove(prev, cur, sizeof(cur));
+      nprev = ncur;
+      interval = millis() - t0;
+      t0 = millis();
+    }
+    if((ncur = procinfo(cur, NPROC)) < 0){
+      fprintf(2, "top: procinfo failed\n");
+      exit(1);
+    }
+    printf("pid\tppid\tstate\tthreads\tKB\tuser ms\tsys ms\tvcsw\tivcsw\tin\tout\t%sname\n",
+           interval > 0 ? "cpu\t" : "");
+    if(interval == 0){
+      for(i = 0; i < ncur; i++)
+        show(&cur[i], 0);
+      continue;
+    }
+    // busiest first.
+    delta();
+    for(i = 0; i < ncur; i++){
+      best = -1;
+      for(j = 0; j < ncur; j++)
+        if(busy[j] >= 0 && (best < 0 || busy[j] > busy[best]))
+          best = j;
+      show(&cur[best], interval);
+      busy[best] = -1;
+    }
+    printf("\n");
+  }
+  exit(0);
+}
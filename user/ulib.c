@@ -3,6 +3,11 @@
 #include "kernel/fcntl.h"
 #include "user/user.h"
 
+// memset, memmove, memcmp and strlen work a 64-bit word at a time
+// once their pointers are 8-byte aligned; see kernel/string.c.
+#define WORDALIGNED(p) (((uint64)(p) & 7) == 0)
+#define HASZERO(w) (((w) - 0x0101010101010101UL) & ~(w) & 0x8080808080808080UL)
+
 char*
 strcpy(char *s, const char *t)
 {
@@ -25,21 +30,46 @@ strcmp(const char *p, const char *q)
 uint
 strlen(const char *s)
 {
-  int n;
+  const char *p;
+  const uint64 *w;
 
-  for(n = 0; s[n]; n++)
+  for(p = s; !WORDALIGNED(p); p++)
+    if(*p == 0)
+      return p - s;
+  // an aligned word never crosses a page boundary.
+  for(w = (const uint64*)p; !HASZERO(*w); w++)
     ;
-  return n;
+  for(p = (const char*)w; *p; p++)
+    ;
+  return p - s;
 }
 
 void*
 memset(void *dst, int c, uint n)
 {
   char *cdst = (char *) dst;
-  int i;
-  for(i = 0; i < n; i++){
-    cdst[i] = c;
+  uint64 w, *wdst;
+
+  while(n > 0 && !WORDALIGNED(cdst)){
+    *cdst++ = c;
+    n--;
+  }
+  if(n >= 8){
+    w = (uchar)c;
+    w |= w << 8;
+    w |= w << 16;
+    w |= w << 32;
+    wdst = (uint64*)cdst;
+    for(; n >= 64; n -= 64, wdst += 8){
+      wdst[0] = w; wdst[1] = w; wdst[2] = w; wdst[3] = w;
+      wdst[4] = w; wdst[5] = w; wdst[6] = w; wdst[7] = w;
+    }
+    for(; n >= 8; n -= 8)
+      *wdst++ = w;
+    cdst = (char*)wdst;
   }
+  while(n-- > 0)
+    *cdst++ = c;
   return dst;
 }
 
@@ -52,6 +82,17 @@ strchr(const char *s, char c)
   return 0;
 }
 
+void*
+memchr(const void *s, int c, uint n)
+{
+  const uchar *p = s;
+
+  for(; n > 0; n--, p++)
+    if(*p == (uchar)c)
+      return (void*)p;
+  return 0;
+}
+
 char*
 gets(char *buf, int max)
 {
@@ -100,15 +141,48 @@ memmove(void *vdst, const void *vsrc, int n)
 {
   char *dst;
   const char *src;
+  int words;
 
   dst = vdst;
   src = vsrc;
+  words = ((uint64)src & 7) == ((uint64)dst & 7);
   if (src > dst) {
+    if(words){
+      while(n > 0 && !WORDALIGNED(dst)){
+        *dst++ = *src++;
+        n--;
+      }
+      for(; n >= 32; n -= 32, dst += 32, src += 32){
+        ((uint64*)dst)[0] = ((uint64*)src)[0];
+        ((uint64*)dst)[1] = ((uint64*)src)[1];
+        ((uint64*)dst)[2] = ((uint64*)src)[2];
+        ((uint64*)dst)[3] = ((uint64*)src)[3];
+      }
+      for(; n >= 8; n -= 8, dst += 8, src += 8)
+        *(uint64*)dst = *(uint64*)src;
+    }
     while(n-- > 0)
       *dst++ = *src++;
   } else {
     dst += n;
     src += n;
+    if(words){
+      while(n > 0 && !WORDALIGNED(dst)){
+        *--dst = *--src;
+        n--;
+      }
+      for(; n >= 32; n -= 32){
+        dst -= 32, src -= 32;
+        ((uint64*)dst)[3] = ((uint64*)src)[3];
+        ((uint64*)dst)[2] = ((uint64*)src)[2];
+        ((uint64*)dst)[1] = ((uint64*)src)[1];
+        ((uint64*)dst)[0] = ((uint64*)src)[0];
+      }
+      for(; n >= 8; n -= 8){
+        dst -= 8, src -= 8;
+        *(uint64*)dst = *(uint64*)src;
+      }
+    }
     while(n-- > 0)
       *--dst = *--src;
   }
@@ -119,6 +193,16 @@ int
 memcmp(const void *s1, const void *s2, uint n)
 {
   const char *p1 = s1, *p2 = s2;
+  if(((uint64)p1 & 7) == ((uint64)p2 & 7)){
+    while(n > 0 && !WORDALIGNED(p1)){
+      if(*p1 != *p2)
+        return *p1 - *p2;
+      p1++, p2++, n--;
+    }
+    // skip equal words; the first unequal one is compared bytewise.
+    while(n >= 8 && *(uint64*)p1 == *(uint64*)p2)
+      p1 += 8, p2 += 8, n -= 8;
+  }
   while (n-- > 0) {
     if (*p1 != *p2) {
       return *p1 - *p2;
@@ -134,3 +218,105 @@ memcpy(void *dst, const void *src, uint n)
 {
   return memmove(dst, src, n);
 }
+
+// Mutexes, condition variables and semaphores for threads made
+// by clone().  They stay in user space unless a thread must
+// wait, and then sleep in the kernel with futex_wait().
+
+void
+mutex_init(struct mutex *m)
+{
+  m->v = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  int c;
+
+  if((c = __sync_val_compare_and_swap(&m->v, 0, 1)) == 0)
+    return;
+  // mark the mutex as waited for, so that unlock wakes us.
+  if(c != 2)
+    c = __sync_lock_test_and_set(&m->v, 2);
+  while(c != 0){
+    futex_wait(&m->v, 2);
+    c = __sync_lock_test_and_set(&m->v, 2);
+  }
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->v, 1) != 1){
+    __sync_lock_release(&m->v);
+    futex_wake(&m->v, 1);
+  }
+}
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+// Release m, wait for a signal, and lock m again.
+// As with any condition variable, the caller should
+// check its condition again on return.
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  int seq;
+
+  seq = c->seq;
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  mutex_lock(m);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1 << 30);
+}
+
+void
+sem_init(struct sem *s, int n)
+{
+  s->v = n;
+  s->nwait = 0;
+}
+
+void
+sem_wait(struct sem *s)
+{
+  int v;
+
+  for(;;){
+    v = s->v;
+    if(v > 0){
+      if(__sync_val_compare_and_swap(&s->v, v, v - 1) == v)
+        return;
+      continue;
+    }
+    __sync_fetch_and_add(&s->nwait, 1);
+    futex_wait(&s->v, v);
+    __sync_fetch_and_sub(&s->nwait, 1);
+  }
+}
+
+void
+sem_post(struct sem *s)
+{
+  __sync_fetch_and_add(&s->v, 1);
+  if(s->nwait > 0)
+    futex_wake(&s->v, 1);
+}
@@ -0,0 +1,187 @@
+// Benchmark submitting system calls in batches through the rings
+// from uring_setup(), against making them one at a time: reading
+// and writing a file in small chunks, and opening and closing it.
+// Reports the system calls made per operation, and the time taken.
+//
+// usage: uringbench [chunks [batch]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/fcntl.h"
+#include "kernel/uring.h"
+#include "user/user.h"
+
+#define CHUNK 512
+
+struct uring *r;
+int batch;
+int queued;          // operations queued since the last uring_enter()
+char buf[URING_NSQ][CHUNK];
+
+void
+report(char *what, int ops, int calls, int t)
+{
+  printf("%s: %d ops, %d system calls, %d.%d%d calls/op, %d ms\n",
+         what, ops, calls, calls / ops, calls * 10 / ops % 10,
+         calls * 100 / ops % 10, t);
+}
+
+// Queue an operation; the caller must leave room in the rings.
+void
+queue(int op, int fd, uint64 addr, int len, int off, int flags)
+{
+  struct usqe *e = &r->sq[r->sqtail % URING_NSQ];
+
+  e->op = op;
+  e->fd = fd;
+  e->addr = addr;
+  e->len = len;
+  e->off = off;
+  e->flags = flags;
+  e->data = r->sqtail;
+  __sync_synchronize();
+  r->sqtail++;
+  queued++;
+}
+
+// Submit everything queued, and wait for it all to complete.
+void
+enter(char *what)
+{
+  if(uring_enter(queued, queued) != queued){
+    fprintf(2, "uringbench: %s: uring_enter failed\n", what);
+    exit(1);
+  }
+  queued = 0;
+}
+
+// Submit everything queued; check and consume the completions,
+// each of which should have returned want.  Returns the number
+// of system calls made.
+int
+submit(char *what, int want)
+{
+  struct ucqe *c;
+
+  enter(what);
+  for(; r->cqhead != r->cqtail; r->cqhead++){
+    c = &r->cq[r->cqhead % URING_NCQ];
+    if(c->res != want){
+      fprintf(2, "uringbench: %s: op %d returned %d\n", what, (int)c->data, c->res);
+      exit(1);
+    }
+  }
+  return 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int chunks, i, j, fd, calls, t0, nopen, n;
+  int fds[NOFILE];
+
+  chunks = 1000;
+  batch = 32;
+  if(argc > 1)
+    chunks = atoi(argv[1]);
+  if(argc > 2)
+    batch = atoi(argv[2]);
+  if(chunks < 1 || batch < 1 || batch > URING_NSQ){
+    fprintf(2, "usage: uringbench [chunks [batch, at most %d]]\n", URING_NSQ);
+    exit(1);
+  }
+  if((r = uring_setup()) == (struct uring*)-1){
+    fprintf(2, "uringbench: uring_setup failed\n");
+    exit(1);
+  }
+  memset(buf, 'u', sizeof(buf));
+
+  // one write() per chunk.
+  if((fd = open("uringbench.dat", O_CREATE|O_TRUNC|O_WRONLY)) < 0){
+    fprintf(2, "uringbench: cannot create uringbench.dat\n");
+    exit(1);
+  }
+  t0 = millis();
+  for(i = 0; i < chunks; i++){
+    if(write(fd, buf[0], CHUNK) != CHUNK){
+      fprintf(2, "uringbench: write failed\n");
+      exit(1);
+    }
+  }
+  report("write", chunks, chunks, millis() - t0);
+
+  // batches of pwrites at increasing offsets.
+  t0 = millis();
+  calls = 0;
+  for(i = 0; i < chunks; i += batch){
+    for(j = i; j < chunks && j < i + batch; j++)
+      queue(UOP_WRITE, fd, (uint64)buf[j - i], CHUNK, j * CHUNK, 0);
+    calls += submit("uring write", CHUNK);
+  }
+  report("uring write", chunks, calls, millis() - t0);
+  close(fd);
+
+  // one read() per chunk.
+  if((fd = open("uringbench.dat", O_RDONLY)) < 0){
+    fprintf(2, "uringbench: cannot open uringbench.dat\n");
+    exit(1);
+  }
+  t0 = millis();
+  for(i = 0; i < chunks; i++){
+    if(read(fd, buf[0], CHUNK) != CHUNK){
+      fprintf(2, "uringbench: read failed\n");
+      exit(1);
+    }
+  }
+  report("read", chunks, chunks, millis() - t0);
+
+  // batches of preads.
+  t0 = millis();
+  calls = 0;
+  for(i = 0; i < chunks; i += batch){
+    for(j = i; j < chunks && j < i + batch; j++)
+      queue(UOP_READ, fd, (uint64)buf[j - i], CHUNK, j * CHUNK, 0);
+    calls += submit("uring read", CHUNK);
+  }
+  report("uring read", chunks, calls, millis() - t0);
+  close(fd);
+
+  // open() and close() of the file.
+  t0 = millis();
+  for(i = 0; i < chunks; i++){
+    if((fd = open("uringbench.dat", O_RDONLY)) < 0){
+      fprintf(2, "uringbench: open failed\n");
+      exit(1);
+    }
+    close(fd);
+  }
+  report("open+close", 2 * chunks, 2 * chunks, millis() - t0);
+
+  // batches of opens, then batches closing what they opened;
+  // a batch can open only as many files as there are free fds.
+  nopen = batch < NOFILE - 3 ? batch : NOFILE - 3;
+  t0 = millis();
+  calls = 0;
+  for(i = 0; i < chunks; i += nopen){
+    n = 0;
+    for(j = i; j < chunks && j < i + nopen; j++)
+      queue(UOP_OPEN, 0, (uint64)"uringbench.dat", 0, 0, O_RDONLY);
+    // collect the descriptors before the ring reuses the slots.
+    enter("uring open");
+    calls++;
+    for(; r->cqhead != r->cqtail; r->cqhead++){
+      if((fds[n++] = r->cq[r->cqhead % URING_NCQ].res) < 0){
+        fprintf(2, "uringbench: uring open failed\n");
+        exit(1);
+      }
+    }
+    for(j = 0; j < n; j++)
+      queue(UOP_CLOSE, fds[j], 0, 0, 0, 0);
+    calls += submit("uring close", 0);
+  }
+  report("uring open+close", 2 * chunks, calls, millis() - t0);
+
+  unlink("uringbench.dat");
+  exit(0);
+}
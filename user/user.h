@@ -1,5 +1,25 @@
 struct stat;
 struct rtcdate;
+struct dirstat;
+struct iovec;
+struct cachestat;
+struct pollfd;
+struct uring;
+struct rusage;
+struct procinfo;
+struct sysstat;
+
+// locks for threads made by clone(), in ulib.c.
+struct mutex {
+  int v;        // 0 unlocked, 1 locked, 2 locked and maybe waited for
+};
+struct cond {
+  int seq;      // changed by every signal
+};
+struct sem {
+  int v;        // count
+  int nwait;    // threads sleeping in sem_wait()
+};
 
 // system calls
 int fork(void);
@@ -23,12 +43,40 @@ int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
+int getdents(int, struct dirstat*, int);
+int openat(int, const char*, int);
+int mkdirat(int, const char*);
+int unlinkat(int, const char*);
+int fstatat(int, const char*, struct stat*);
+int readv(int, const struct iovec*, int);
+int writev(int, const struct iovec*, int);
+int pread(int, void*, int, int);
+int pwrite(int, const void*, int, int);
+int sendfile(int, int, int);
+int cachestat(struct cachestat*);
+int fsync(int);
+int clone(void(*)(void*), void*, void*);
+int join(int, int*);
+int futex_wait(int*, int);
+int futex_wake(int*, int);
+int poll(struct pollfd*, int, int);
+int fcntl(int, int, int);
+struct uring* uring_setup(void);
+int uring_enter(int, int);
+int fallocate(int, int, int);
+int usleep(int);
+int prof(int, void*, int);
+int ktrace(int, void*, int);
+int getrusage(int, struct rusage*);
+int procinfo(struct procinfo*, int);
+int sysstat(int, struct sysstat*, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
 char* strcpy(char*, const char*);
 void *memmove(void*, const void*, int);
 char* strchr(const char*, char c);
+void* memchr(const void*, int, uint);
 int strcmp(const char*, const char*);
 void fprintf(int, const char*, ...);
 void printf(const char*, ...);
@@ -40,3 +88,28 @@ void free(void*);
 int atoi(const char*);
 int memcmp(const void *, const void *, uint);
 void *memcpy(void *, const void *, uint);
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
+void sem_init(struct sem*, int);
+void sem_wait(struct sem*);
+void sem_post(struct sem*);
+
+// gthread.c
+int gthread_create(void (*)(void*), void*);
+void gthread_yield(void);
+void gthread_exit(void);
+void gthread_run(void);
+int gthread_read(int, void*, int);
+int gthread_write(int, const void*, int);
+
+// bench.c
+uint64 rdcycle(void);
+uint64 rdtime(void);
+int millis(void);
+uint64 rdinstret(void);
+void bench(char*, void (*)(void), int, int, int);
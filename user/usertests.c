@@ -7,6 +7,11 @@
 #include "kernel/syscall.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
+#include "kernel/uring.h"
+#include "kernel/prof.h"
+#include "kernel/trace.h"
+#include "kernel/rusage.h"
+#include "kernel/sysstat.h"
 
 //
 // Tests xv6 system calls.  usertests without arguments runs them all
@@ -2003,6 +2008,1260 @@ dirfile(char *s)
   close(fd);
 }
 
+// getdents() should return every live entry, with the
+// attributes stat() would report.
+void
+getdentstest(char *s)
+{
+  int fd, i, n, tot, seen;
+  struct dirstat ds[3];
+  struct stat st;
+
+  if(mkdir("gdd") != 0){
+    printf("%s: mkdir gdd failed\n", s);
+    exit(1);
+  }
+  fd = open("gdd/a", O_CREATE|O_RDWR);
+  write(fd, "hello", 5);
+  close(fd);
+  fd = open("gdd/b", O_CREATE|O_RDWR);
+  close(fd);
+  fd = open("gdd/c", O_CREATE|O_RDWR);
+  close(fd);
+  unlink("gdd/b");  // leaves an empty slot
+  mkdir("gdd/d");
+
+  fd = open("gdd", O_RDONLY);
+  tot = 0;
+  seen = 0;
+  while((n = getdents(fd, ds, 3)) > 0){
+    for(i = 0; i < n; i++){
+      tot++;
+      if(strcmp(ds[i].name, "a") == 0){
+        if(ds[i].type != T_FILE || ds[i].size != 5){
+          printf("%s: gdd/a wrong type or size\n", s);
+          exit(1);
+        }
+        if(stat("gdd/a", &st) < 0 || st.ino != ds[i].inum){
+          printf("%s: gdd/a wrong inum\n", s);
+          exit(1);
+        }
+        seen |= 1;
+      } else if(strcmp(ds[i].name, "d") == 0){
+        if(ds[i].type != T_DIR){
+          printf("%s: gdd/d not a directory\n", s);
+          exit(1);
+        }
+        seen |= 2;
+      } else if(strcmp(ds[i].name, "b") == 0){
+        printf("%s: unlinked gdd/b returned\n", s);
+        exit(1);
+      }
+    }
+  }
+  close(fd);
+  if(n < 0 || tot != 5 || seen != 3){
+    printf("%s: getdents returned %d entries\n", s, tot);
+    exit(1);
+  }
+
+  fd = open("gdd/a", O_RDONLY);
+  if(getdents(fd, ds, 3) >= 0){
+    printf("%s: getdents on a file succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  unlink("gdd/a");
+  unlink("gdd/c");
+  unlink("gdd/d");
+  unlink("gdd");
+}
+
+// the *at() calls resolve relative paths from a directory fd.
+void
+attest(char *s)
+{
+  int dfd, fd;
+  struct stat st;
+
+  if(mkdir("atd") != 0){
+    printf("%s: mkdir atd failed\n", s);
+    exit(1);
+  }
+  dfd = open("atd", O_RDONLY);
+  if(mkdirat(dfd, "sub") != 0){
+    printf("%s: mkdirat failed\n", s);
+    exit(1);
+  }
+  fd = openat(dfd, "sub/f", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, "abc", 3) != 3){
+    printf("%s: openat create failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  if(fstatat(dfd, "sub/f", &st) != 0 || st.type != T_FILE || st.size != 3){
+    printf("%s: fstatat sub/f failed\n", s);
+    exit(1);
+  }
+  if(stat("atd/sub/f", &st) != 0 || st.size != 3){
+    printf("%s: atd/sub/f not where expected\n", s);
+    exit(1);
+  }
+  if(fstatat(AT_FDCWD, "atd/sub", &st) != 0 || st.type != T_DIR){
+    printf("%s: fstatat AT_FDCWD failed\n", s);
+    exit(1);
+  }
+  if(unlinkat(dfd, "sub") == 0){
+    printf("%s: unlinkat non-empty directory succeeded\n", s);
+    exit(1);
+  }
+  fd = open("atd/sub/f", O_RDONLY);
+  if(openat(fd, "x", O_RDONLY) >= 0 || mkdirat(fd, "x") == 0){
+    printf("%s: *at() relative to a file succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+  if(unlinkat(dfd, "sub/f") != 0 || unlinkat(dfd, "sub") != 0){
+    printf("%s: unlinkat failed\n", s);
+    exit(1);
+  }
+  if(fstatat(dfd, "sub", &st) == 0){
+    printf("%s: sub still exists\n", s);
+    exit(1);
+  }
+  close(dfd);
+  if(unlink("atd") != 0){
+    printf("%s: unlink atd failed\n", s);
+    exit(1);
+  }
+}
+
+// readv/writev gather and scatter across buffers, and
+// pread/pwrite leave the file offset alone.
+void
+iovtest(char *s)
+{
+  int fd, p[2];
+  char a[3], b[5], c[8];
+  struct iovec iov[3];
+
+  unlink("iovf");
+  fd = open("iovf", O_CREATE|O_RDWR);
+  iov[0].iov_base = "abc";
+  iov[0].iov_len = 3;
+  iov[1].iov_base = "";
+  iov[1].iov_len = 0;
+  iov[2].iov_base = "defgh";
+  iov[2].iov_len = 5;
+  if(fd < 0 || writev(fd, iov, 3) != 8){
+    printf("%s: writev failed\n", s);
+    exit(1);
+  }
+  if(pwrite(fd, "XY", 2, 2) != 2 || write(fd, "ij", 2) != 2){
+    printf("%s: pwrite failed\n", s);
+    exit(1);
+  }
+  if(pread(fd, c, sizeof(c), 0) != 8 || memcmp(c, "abXYefgh", 8) != 0){
+    printf("%s: pread read wrong data\n", s);
+    exit(1);
+  }
+  if(pread(fd, c, sizeof(c), 100) != 0 || pwrite(fd, c, 1, 100) >= 0){
+    printf("%s: p{read,write} beyond end of file\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  fd = open("iovf", O_RDONLY);
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof(a);
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof(b);
+  iov[2].iov_base = c;
+  iov[2].iov_len = sizeof(c);
+  if(readv(fd, iov, 3) != 10 || memcmp(a, "abX", 3) != 0 ||
+     memcmp(b, "Yefgh", 5) != 0 || memcmp(c, "ij", 2) != 0){
+    printf("%s: readv read wrong data\n", s);
+    exit(1);
+  }
+  if(readv(fd, iov, 3) != 0){
+    printf("%s: readv at end of file\n", s);
+    exit(1);
+  }
+  if(readv(fd, iov, 1000) >= 0 || readv(fd, iov, -1) >= 0){
+    printf("%s: readv with bad count succeeded\n", s);
+    exit(1);
+  }
+  if(pread(fd, a, 1, -1) >= 0 || pread(fd, (char*)0xffffffffffL, 1, 0) >= 0){
+    printf("%s: bad offset or address succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("iovf");
+
+  if(pipe(p) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  iov[0].iov_base = "12";
+  iov[0].iov_len = 2;
+  iov[1].iov_base = "345";
+  iov[1].iov_len = 3;
+  if(writev(p[1], iov, 2) != 5 || pwrite(p[1], "x", 1, 0) >= 0 ||
+     pread(p[0], c, 1, 0) >= 0){
+    printf("%s: pipe writev or pread/pwrite\n", s);
+    exit(1);
+  }
+  iov[0].iov_base = c;
+  iov[0].iov_len = sizeof(c);
+  if(readv(p[0], iov, 1) != 5 || memcmp(c, "12345", 5) != 0){
+    printf("%s: pipe readv read wrong data\n", s);
+    exit(1);
+  }
+  close(p[0]);
+  close(p[1]);
+}
+
+// sendfile copies between descriptors inside the kernel,
+// advancing both offsets.
+void
+sendfiletest(char *s)
+{
+  int in, out, p[2], i, n;
+  static char buf[3*BSIZE+10], got[3*BSIZE+10];
+
+  for(i = 0; i < sizeof(buf); i++)
+    buf[i] = 'a' + i % 26;
+  unlink("sfin");
+  unlink("sfout");
+  in = open("sfin", O_CREATE|O_RDWR);
+  if(in < 0 || write(in, buf, sizeof(buf)) != sizeof(buf)){
+    printf("%s: cannot create sfin\n", s);
+    exit(1);
+  }
+  close(in);
+
+  in = open("sfin", O_RDONLY);
+  out = open("sfout", O_CREATE|O_RDWR);
+  if(read(in, got, 7) != 7 || write(out, "xy", 2) != 2){
+    printf("%s: read/write failed\n", s);
+    exit(1);
+  }
+  if(sendfile(out, in, 10) != 10 || sendfile(out, in, sizeof(buf)) != sizeof(buf)-17 ||
+     sendfile(out, in, 10) != 0){
+    printf("%s: sendfile returned wrong count\n", s);
+    exit(1);
+  }
+  if(sendfile(in, out, 1) >= 0 || sendfile(out, in, -1) >= 0){
+    printf("%s: sendfile to read-only file or of -1 bytes succeeded\n", s);
+    exit(1);
+  }
+  close(out);
+  out = open("sfout", O_RDONLY);
+  if(read(out, got, sizeof(got)) != sizeof(buf)-5 || memcmp(got, "xy", 2) != 0 ||
+     memcmp(got+2, buf+7, sizeof(buf)-7) != 0){
+    printf("%s: sfout has wrong contents\n", s);
+    exit(1);
+  }
+  close(out);
+
+  // file to pipe
+  if(pipe(p) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(fork() == 0){
+    close(p[0]);
+    in = open("sfin", O_RDONLY);
+    if(sendfile(p[1], in, sizeof(buf)) != sizeof(buf))
+      exit(1);
+    exit(0);
+  }
+  close(p[1]);
+  for(i = 0; (n = read(p[0], got+i, sizeof(got)-i)) > 0; i += n)
+    ;
+  wait(&n);
+  if(n != 0 || i != sizeof(buf) || memcmp(got, buf, sizeof(buf)) != 0){
+    printf("%s: sendfile to pipe failed\n", s);
+    exit(1);
+  }
+  close(p[0]);
+  close(in);
+  unlink("sfin");
+  unlink("sfout");
+}
+
+// reads through the page cache must see every write, truncate
+// and append, and rereading a file should hit in the cache.
+void
+pcachetest(char *s)
+{
+  int fd, i;
+  static char buf[2*PGSIZE+100], got[2*PGSIZE+100];
+  struct cachestat a, b;
+
+  for(i = 0; i < sizeof(buf); i++)
+    buf[i] = 'a' + i % 23;
+  unlink("pcf");
+  fd = open("pcf", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)){
+    printf("%s: cannot write pcf\n", s);
+    exit(1);
+  }
+  if(pread(fd, got, sizeof(got), 0) != sizeof(buf) || memcmp(got, buf, sizeof(buf)) != 0){
+    printf("%s: first read wrong\n", s);
+    exit(1);
+  }
+  cachestat(&a);
+  if(pread(fd, got, sizeof(got), 0) != sizeof(buf) || memcmp(got, buf, sizeof(buf)) != 0){
+    printf("%s: second read wrong\n", s);
+    exit(1);
+  }
+  cachestat(&b);
+  if(b.phit - a.phit < 3){
+    printf("%s: rereading missed the page cache\n", s);
+    exit(1);
+  }
+
+  // overwrite across a page boundary.
+  memmove(buf+PGSIZE-2, "XYZXY", 5);
+  if(pwrite(fd, "XYZXY", 5, PGSIZE-2) != 5 ||
+     pread(fd, got, sizeof(got), 0) != sizeof(buf) || memcmp(got, buf, sizeof(buf)) != 0){
+    printf("%s: overwrite not seen\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  // truncate, then grow again.
+  fd = open("pcf", O_TRUNC|O_RDWR);
+  if(fd < 0 || write(fd, "short", 5) != 5 || pread(fd, got, sizeof(got), 0) != 5 ||
+     memcmp(got, "short", 5) != 0){
+    printf("%s: truncate not seen\n", s);
+    exit(1);
+  }
+  if(write(fd, buf, PGSIZE) != PGSIZE ||
+     pread(fd, got, sizeof(got), 0) != PGSIZE+5 ||
+     memcmp(got, "short", 5) != 0 || memcmp(got+5, buf, PGSIZE) != 0){
+    printf("%s: append not seen\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("pcf");
+}
+
+// fsync waits for the log to commit, and works only on files.
+void
+fsynctest(char *s)
+{
+  int fd, p[2];
+  struct cachestat cs;
+
+  fd = open("fsyncf", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, "hello", 5) != 5){
+    printf("%s: cannot write fsyncf\n", s);
+    exit(1);
+  }
+  if(fsync(fd) != 0){
+    printf("%s: fsync failed\n", s);
+    exit(1);
+  }
+  if(cachestat(&cs) != 0 || cs.ndirty != 0){
+    printf("%s: dirty buffers after fsync\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("fsyncf");
+  if(pipe(p) < 0 || fsync(p[0]) == 0){
+    printf("%s: fsync of a pipe succeeded\n", s);
+    exit(1);
+  }
+  close(p[0]);
+  close(p[1]);
+}
+
+// deleted large files and exited processes are freed by the
+// work queue; make sure the space really comes back.
+void
+workqtest(char *s)
+{
+  int i, j, fd, pid, xstatus;
+  static char buf[BSIZE];
+
+  // more data in total than the file system holds.
+  memset(buf, 'w', sizeof(buf));
+  for(i = 0; i < 50; i++){
+    fd = open("wqbig", O_CREATE|O_WRONLY);
+    if(fd < 0){
+      printf("%s: cannot create wqbig\n", s);
+      exit(1);
+    }
+    for(j = 0; j < 250; j++){
+      if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+        printf("%s: write wqbig failed at round %d\n", s, i);
+        exit(1);
+      }
+    }
+    close(fd);
+    if(unlink("wqbig") != 0){
+      printf("%s: unlink wqbig failed\n", s);
+      exit(1);
+    }
+  }
+
+  // more memory in total than the machine has.
+  for(i = 0; i < 20; i++){
+    if((pid = fork()) < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      char *p = sbrk(20*1024*1024);
+      if(p == (char*)-1)
+        exit(1);
+      for(j = 0; j < 20*1024*1024; j += PGSIZE)
+        p[j] = 1;
+      exit(0);
+    }
+    wait(&xstatus);
+    if(xstatus != 0){
+      printf("%s: sbrk failed in child %d\n", s, i);
+      exit(1);
+    }
+  }
+}
+
+char *clonemem;
+
+// body of the threads made by clonetest().
+void
+clonechild(void *arg)
+{
+  int *fds = arg;
+  char c;
+
+  switch(fds[0]){
+  case 0:
+    // grow the memory shared with the parent.
+    if((clonemem = sbrk(PGSIZE)) == (char*)-1)
+      exit(1);
+    clonemem[100] = 'T';
+    exit(7);
+  case 1:
+    // wait for the parent to shrink and grow memory.
+    if(read(fds[1], &c, 1) != 1 || c != 'x')
+      exit(1);
+    exit(0);
+  case 2:
+    // open a file and change directory for the whole group.
+    if(chdir("clonedir") < 0)
+      exit(1);
+    if((fds[1] = open("f", O_CREATE|O_RDWR)) < 0)
+      exit(1);
+    if(write(fds[1], "t", 1) != 1)
+      exit(1);
+    exit(0);
+  default:
+    for(;;)
+      ;
+  }
+}
+
+// threads share memory, open files and the current directory
+// with the group, are joined rather than waited for, and die
+// with their group's leader.
+void
+clonetest(char *s)
+{
+  int arg[2], pfd[2], tid, xstatus, pid;
+  char c, *stack, *a, *argv[] = { "echo", 0 };
+
+  if((stack = malloc(PGSIZE)) == 0){
+    printf("%s: malloc failed\n", s);
+    exit(1);
+  }
+
+  arg[0] = 0;
+  tid = clone(clonechild, arg, stack + PGSIZE);
+  if(tid < 0){
+    printf("%s: clone failed\n", s);
+    exit(1);
+  }
+  if(exec("echo", argv) >= 0){
+    printf("%s: exec with a thread succeeded\n", s);
+    exit(1);
+  }
+  if(wait(0) != -1){
+    printf("%s: wait returned a thread\n", s);
+    exit(1);
+  }
+  if(join(tid, &xstatus) != tid || xstatus != 7){
+    printf("%s: join failed\n", s);
+    exit(1);
+  }
+  if(join(tid, 0) != -1){
+    printf("%s: joined a thread twice\n", s);
+    exit(1);
+  }
+  if(clonemem == 0 || clonemem[100] != 'T'){
+    printf("%s: memory the thread allocated is not shared\n", s);
+    exit(1);
+  }
+
+  // shrink memory while another thread may be running.
+  if(pipe(pfd) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  arg[0] = 1;
+  arg[1] = pfd[0];
+  if((tid = clone(clonechild, arg, stack + PGSIZE)) < 0){
+    printf("%s: clone failed\n", s);
+    exit(1);
+  }
+  a = sbrk(10*PGSIZE);
+  if(a == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  a[0] = 1;
+  if(sbrk(-10*PGSIZE) == (char*)-1 || sbrk(0) != a){
+    printf("%s: shrinking shared memory failed\n", s);
+    exit(1);
+  }
+  write(pfd[1], "x", 1);
+  if(join(tid, &xstatus) != tid || xstatus != 0){
+    printf("%s: join failed\n", s);
+    exit(1);
+  }
+  close(pfd[0]);
+  close(pfd[1]);
+
+  // a file the thread opened, and its chdir(), outlive it.
+  if(mkdir("clonedir") < 0){
+    printf("%s: mkdir failed\n", s);
+    exit(1);
+  }
+  arg[0] = 2;
+  if((tid = clone(clonechild, arg, stack + PGSIZE)) < 0){
+    printf("%s: clone failed\n", s);
+    exit(1);
+  }
+  if(join(tid, &xstatus) != tid || xstatus != 0){
+    printf("%s: thread could not open a file\n", s);
+    exit(1);
+  }
+  if(pread(arg[1], &c, 1, 0) != 1 || c != 't'){
+    printf("%s: file the thread opened is not shared\n", s);
+    exit(1);
+  }
+  close(arg[1]);
+  if(unlink("f") < 0){
+    printf("%s: thread's chdir is not shared\n", s);
+    exit(1);
+  }
+  if(chdir("/") < 0 || unlink("clonedir") < 0){
+    printf("%s: cannot remove clonedir\n", s);
+    exit(1);
+  }
+
+  // a leader's exit kills its threads.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    arg[0] = 3;
+    if(clone(clonechild, arg, stack + PGSIZE) < 0)
+      exit(1);
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0){
+    printf("%s: clone in child failed\n", s);
+    exit(1);
+  }
+  if(join(pid, 0) != -1){
+    printf("%s: joined a process\n", s);
+    exit(1);
+  }
+  free(stack);
+}
+
+struct mutex futexmu;
+struct cond futexcv;
+int futexcount, futexready;
+
+void
+futexchild(void *arg)
+{
+  int i;
+
+  mutex_lock(&futexmu);
+  while(!futexready)
+    cond_wait(&futexcv, &futexmu);
+  mutex_unlock(&futexmu);
+  for(i = 0; i < 1000; i++){
+    mutex_lock(&futexmu);
+    futexcount++;
+    mutex_unlock(&futexmu);
+  }
+  exit(0);
+}
+
+// futex_wait() only sleeps if the word holds the expected value;
+// mutexes and condition variables built on it work across threads.
+void
+futextest(char *s)
+{
+  int w, i, tid[4];
+  char *stack[4];
+
+  w = 1;
+  if(futex_wait(&w, 0) != -1){
+    printf("%s: futex_wait slept on a changed word\n", s);
+    exit(1);
+  }
+  if(futex_wait((int*)0xffffffffffL, 0) != -1 || futex_wake((int*)((char*)&w + 1), 1) != -1){
+    printf("%s: futex accepted a bad address\n", s);
+    exit(1);
+  }
+  if(futex_wake(&w, 1) != 0){
+    printf("%s: futex_wake woke someone\n", s);
+    exit(1);
+  }
+
+  mutex_init(&futexmu);
+  cond_init(&futexcv);
+  for(i = 0; i < 4; i++){
+    stack[i] = malloc(PGSIZE);
+    if((tid[i] = clone(futexchild, 0, stack[i] + PGSIZE)) < 0){
+      printf("%s: clone failed\n", s);
+      exit(1);
+    }
+  }
+  sleep(1);
+  mutex_lock(&futexmu);
+  futexready = 1;
+  cond_broadcast(&futexcv);
+  mutex_unlock(&futexmu);
+  for(i = 0; i < 4; i++){
+    if(join(tid[i], 0) != tid[i]){
+      printf("%s: join failed\n", s);
+      exit(1);
+    }
+    free(stack[i]);
+  }
+  if(futexcount != 4000){
+    printf("%s: count is %d, not 4000\n", s, futexcount);
+    exit(1);
+  }
+}
+
+char gtorder[16];
+int gtn;
+
+void
+gtchild(void *arg)
+{
+  int i;
+
+  for(i = 0; i < 3; i++){
+    gtorder[gtn++] = (char)(uint64)arg;
+    gthread_yield();
+  }
+}
+
+// green threads take turns, and gthread_run() returns when
+// they have all finished.
+void
+gthreadtest(char *s)
+{
+  int i;
+
+  for(i = 0; i < 3; i++){
+    if(gthread_create(gtchild, (void*)(uint64)('a' + i)) < 0){
+      printf("%s: gthread_create failed\n", s);
+      exit(1);
+    }
+  }
+  gthread_run();
+  gtorder[gtn] = 0;
+  if(strcmp(gtorder, "abcabcabc") != 0){
+    printf("%s: threads ran in order %s\n", s, gtorder);
+    exit(1);
+  }
+}
+
+// poll() reports pipe readiness, times out, and wakes
+// when a child writes.
+void
+polltest(char *s)
+{
+  struct pollfd pfd[3];
+  int p[2], t0, n;
+  char c;
+
+  if(pipe(p) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pfd[0].fd = p[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = p[1];
+  pfd[1].events = POLLOUT;
+  pfd[2].fd = -1;
+  pfd[2].events = POLLIN;
+  if(poll(pfd, 3, 0) != 1 || pfd[0].revents != 0 || pfd[1].revents != POLLOUT || pfd[2].revents != 0){
+    printf("%s: poll of empty pipe wrong\n", s);
+    exit(1);
+  }
+
+  t0 = uptime();
+  if(poll(pfd, 1, 2) != 0 || uptime() - t0 < 1){
+    printf("%s: poll did not time out\n", s);
+    exit(1);
+  }
+
+  if(fork() == 0){
+    sleep(2);
+    write(p[1], "x", 1);
+    exit(0);
+  }
+  if((n = poll(pfd, 1, -1)) != 1 || pfd[0].revents != POLLIN){
+    printf("%s: poll returned %d, revents %x\n", s, n, pfd[0].revents);
+    exit(1);
+  }
+  wait(0);
+  read(p[0], &c, 1);
+
+  close(p[1]);
+  if(poll(pfd, 1, -1) != 1 || pfd[0].revents != (POLLIN|POLLHUP)){
+    printf("%s: no POLLHUP after close\n", s);
+    exit(1);
+  }
+  close(p[0]);
+  if(poll(pfd, 1, 0) != 1 || pfd[0].revents != POLLNVAL){
+    printf("%s: no POLLNVAL for closed fd\n", s);
+    exit(1);
+  }
+}
+
+// O_NONBLOCK pipes return EAGAIN instead of sleeping.
+void
+nonblocktest(char *s)
+{
+  int p[2], n, tot;
+  char buf[100];
+
+  if(pipe(p) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(fcntl(p[0], F_GETFL, 0) != O_RDONLY || fcntl(p[1], F_GETFL, 0) != O_WRONLY){
+    printf("%s: wrong F_GETFL for a pipe\n", s);
+    exit(1);
+  }
+  if(fcntl(p[0], F_SETFL, O_NONBLOCK) != 0 || fcntl(p[1], F_SETFL, O_NONBLOCK) != 0 ||
+     fcntl(p[0], F_GETFL, 0) != (O_RDONLY|O_NONBLOCK)){
+    printf("%s: F_SETFL failed\n", s);
+    exit(1);
+  }
+  if((n = read(p[0], buf, sizeof(buf))) != EAGAIN){
+    printf("%s: read of empty pipe returned %d\n", s, n);
+    exit(1);
+  }
+
+  // fill the pipe; the last write is short, then EAGAIN.
+  memset(buf, 'n', sizeof(buf));
+  tot = 0;
+  while((n = write(p[1], buf, sizeof(buf))) > 0)
+    tot += n;
+  if(n != EAGAIN || tot == 0 || tot % sizeof(buf) == 0){
+    printf("%s: filling the pipe: %d then %d\n", s, tot, n);
+    exit(1);
+  }
+  while((n = read(p[0], buf, sizeof(buf))) > 0)
+    tot -= n;
+  if(n != EAGAIN || tot != 0){
+    printf("%s: draining the pipe: %d left, then %d\n", s, tot, n);
+    exit(1);
+  }
+
+  close(p[1]);
+  if(read(p[0], buf, sizeof(buf)) != 0){
+    printf("%s: no end of file\n", s);
+    exit(1);
+  }
+  close(p[0]);
+}
+
+// a batch of operations through the rings from uring_setup()
+// completes in order, in one uring_enter(), and an operation
+// that blocks does not block the process.
+void
+uringtest(char *s)
+{
+  struct uring *r;
+  struct usqe *e;
+  struct ucqe *c;
+  char buf[8], *argv[] = { "echo", "uring", 0 };
+  int fd, pid, xstatus, pfd[2];
+
+  if((r = uring_setup()) == (struct uring*)-1){
+    printf("%s: uring_setup failed\n", s);
+    exit(1);
+  }
+  if(uring_setup() != r){
+    printf("%s: second uring_setup gave a different ring\n", s);
+    exit(1);
+  }
+  if(uring_enter(1, 0) != 0){
+    printf("%s: uring_enter of an empty ring did something\n", s);
+    exit(1);
+  }
+
+  e = &r->sq[r->sqtail % URING_NSQ];
+  memset(e, 0, sizeof(*e));
+  e->op = UOP_OPEN;
+  e->addr = (uint64)"uringfile";
+  e->flags = O_CREATE|O_RDWR;
+  e->data = 1;
+  r->sqtail++;
+  if(uring_enter(1, 1) != 1 || r->cqtail != 1 || r->cq[0].data != 1 ||
+     (fd = r->cq[0].res) < 0){
+    printf("%s: open through the ring failed\n", s);
+    exit(1);
+  }
+  r->cqhead++;
+
+  // write, read back at offset 0, close: one system call.
+  e = &r->sq[r->sqtail++ % URING_NSQ];
+  memset(e, 0, sizeof(*e));
+  e->op = UOP_WRITE;
+  e->fd = fd;
+  e->addr = (uint64)"ringing";
+  e->len = 7;
+  e->off = -1;
+  e->data = 2;
+  e = &r->sq[r->sqtail++ % URING_NSQ];
+  memset(e, 0, sizeof(*e));
+  e->op = UOP_READ;
+  e->fd = fd;
+  e->addr = (uint64)buf;
+  e->len = sizeof(buf);
+  e->off = 0;
+  e->data = 3;
+  e = &r->sq[r->sqtail++ % URING_NSQ];
+  memset(e, 0, sizeof(*e));
+  e->op = UOP_CLOSE;
+  e->fd = fd;
+  e->data = 4;
+  if(uring_enter(10, 3) != 3 || r->sqhead != r->sqtail || r->cqtail != 4){
+    printf("%s: batch did not complete\n", s);
+    exit(1);
+  }
+  if(r->cq[1].data != 2 || r->cq[1].res != 7 ||
+     r->cq[2].data != 3 || r->cq[2].res != 7 || memcmp(buf, "ringing", 7) != 0 ||
+     r->cq[3].data != 4 || r->cq[3].res != 0){
+    printf("%s: wrong completions\n", s);
+    exit(1);
+  }
+  r->cqhead = r->cqtail;
+  if(close(fd) == 0){
+    printf("%s: fd still open after close through the ring\n", s);
+    exit(1);
+  }
+
+  // a bad fd fails that operation only.
+  e = &r->sq[r->sqtail++ % URING_NSQ];
+  memset(e, 0, sizeof(*e));
+  e->op = UOP_CLOSE;
+  e->fd = fd;
+  e->data = 5;
+  if(uring_enter(1, 1) != 1 || r->cq[4].res != -1){
+    printf("%s: close of a closed fd succeeded\n", s);
+    exit(1);
+  }
+  r->cqhead = r->cqtail;
+
+  // a read of an empty pipe completes once there is data,
+  // while the process goes on.
+  if(pipe(pfd) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  e = &r->sq[r->sqtail++ % URING_NSQ];
+  memset(e, 0, sizeof(*e));
+  e->op = UOP_READ;
+  e->fd = pfd[0];
+  e->addr = (uint64)buf;
+  e->len = 1;
+  e->off = -1;
+  e->data = 6;
+  if(uring_enter(1, 0) != 1){
+    printf("%s: uring_enter of a read failed\n", s);
+    exit(1);
+  }
+  if(r->cqtail != r->cqhead){
+    printf("%s: read of an empty pipe completed\n", s);
+    exit(1);
+  }
+  if(write(pfd[1], "p", 1) != 1){
+    printf("%s: write to pipe failed\n", s);
+    exit(1);
+  }
+  c = &r->cq[r->cqhead % URING_NCQ];
+  if(uring_enter(0, 1) != 0 || r->cqtail == r->cqhead ||
+     c->data != 6 || c->res != 1 || buf[0] != 'p'){
+    printf("%s: read of a pipe did not complete\n", s);
+    exit(1);
+  }
+  r->cqhead = r->cqtail;
+  close(pfd[0]);
+  close(pfd[1]);
+
+  // children do not inherit the ring.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0)
+    exit(uring_enter(1, 0) == -1 ? 0 : 1);
+  wait(&xstatus);
+  if(xstatus != 0){
+    printf("%s: child used its parent's ring\n", s);
+    exit(1);
+  }
+
+  // exec() stops the ring's worker and drops the ring.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(uring_setup() == (struct uring*)-1)
+      exit(1);
+    exec("echo", argv);
+    exit(1);
+  }
+  wait(&xstatus);
+  if(xstatus != 0){
+    printf("%s: exec with a ring failed\n", s);
+    exit(1);
+  }
+  unlink("uringfile");
+}
+
+// fallocate() grows a file with zeroed blocks, and leaves
+// alone what is already there.
+void
+fallocatetest(char *s)
+{
+  int fd, i, n;
+  struct stat st;
+
+  unlink("falloc");
+  if((fd = open("falloc", O_CREATE|O_RDWR)) < 0){
+    printf("%s: create falloc failed\n", s);
+    exit(1);
+  }
+  if(write(fd, "hello", 5) != 5){
+    printf("%s: write failed\n", s);
+    exit(1);
+  }
+  // more than one transaction's worth, and into the indirect block.
+  if(fallocate(fd, BSIZE, (NDIRECT+10)*BSIZE) != 0){
+    printf("%s: fallocate failed\n", s);
+    exit(1);
+  }
+  if(fstat(fd, &st) < 0 || st.size != (NDIRECT+11)*BSIZE){
+    printf("%s: wrong size %d after fallocate\n", s, (int)st.size);
+    exit(1);
+  }
+  if(fallocate(fd, 0, BSIZE) != 0 || fstat(fd, &st) < 0 || st.size != (NDIRECT+11)*BSIZE){
+    printf("%s: fallocate within the file changed it\n", s);
+    exit(1);
+  }
+  for(i = 0; i < NDIRECT+11; i++){
+    if((n = pread(fd, buf, BSIZE, i*BSIZE)) != BSIZE){
+      printf("%s: pread of block %d returned %d\n", s, i, n);
+      exit(1);
+    }
+    for(n = (i == 0 ? 5 : 0); n < BSIZE; n++){
+      if(buf[n] != 0){
+        printf("%s: block %d not zeroed\n", s, i);
+        exit(1);
+      }
+    }
+  }
+  if(pread(fd, buf, 5, 0) != 5 || memcmp(buf, "hello", 5) != 0){
+    printf("%s: fallocate lost data\n", s);
+    exit(1);
+  }
+  if(fallocate(fd, 0, (MAXFILE+1)*BSIZE) != -1 || fallocate(fd, -1, 10) != -1){
+    printf("%s: fallocate past MAXFILE or before 0 succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  fd = open("falloc", O_RDONLY);
+  if(fallocate(fd, 0, (NDIRECT+20)*BSIZE) != -1){
+    printf("%s: fallocate of a read-only fd succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("falloc");
+}
+
+// usleep() can sleep for less than a tick, sleep() still sleeps
+// until a tick boundary, and kill() ends either early.
+void
+usleeptest(char *s)
+{
+  int i, t0, t, pid, xstatus;
+
+  t0 = uptime();
+  for(i = 0; i < 20; i++){
+    if(usleep(1000) != 0){
+      printf("%s: usleep failed\n", s);
+      exit(1);
+    }
+  }
+  // 20 ms in all, where a tick is 100 ms.
+  if((t = uptime() - t0) > 5){
+    printf("%s: 20 usleep(1000)s took %d ticks\n", s, t);
+    exit(1);
+  }
+
+  t0 = uptime();
+  if(sleep(3) != 0 || (t = uptime() - t0) < 3){
+    printf("%s: sleep(3) took %d ticks\n", s, t);
+    exit(1);
+  }
+
+  t0 = uptime();
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    usleep(100*1000*1000);
+    exit(0);
+  }
+  sleep(1);
+  kill(pid);
+  wait(&xstatus);
+  if(xstatus != -1 || (t = uptime() - t0) > 20){
+    printf("%s: killed usleep: status %d after %d ticks\n", s, xstatus, t);
+    exit(1);
+  }
+}
+
+// the profiler should catch this process in user space
+// while it spins.
+void
+proftest(char *s)
+{
+  struct profsample ps[16];
+  int i, n, mine, t0;
+  volatile int x = 0;
+
+  if(prof(PROF_START, 0, 0) != 0){
+    printf("%s: PROF_START failed\n", s);
+    exit(1);
+  }
+  t0 = uptime();
+  while(uptime() - t0 < 2)
+    x++;
+  prof(PROF_STOP, 0, 0);
+  mine = 0;
+  while((n = prof(PROF_READ, ps, 16)) > 0){
+    for(i = 0; i < n; i++){
+      if(ps[i].pid == getpid() && ps[i].user){
+        if(ps[i].pc[0] >= (uint64)sbrk(0)){
+          printf("%s: sample pc %p not in the program\n", s, ps[i].pc[0]);
+          exit(1);
+        }
+        mine++;
+      }
+    }
+  }
+  if(n < 0 || mine == 0){
+    printf("%s: no samples\n", s);
+    exit(1);
+  }
+}
+
+// the kernel's trace should hold this process's system calls.
+void
+ktracetest(char *s)
+{
+  struct traceev ev[32];
+  int i, n, calls, rets;
+
+  if(ktrace(TRACE_START, 0, 0) != 0){
+    printf("%s: TRACE_START failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 5; i++)
+    getpid();
+  if(ktrace(TRACE_STOP, 0, 0) < 0){
+    printf("%s: TRACE_STOP failed\n", s);
+    exit(1);
+  }
+  calls = rets = 0;
+  while((n = ktrace(TRACE_READ, ev, 32)) > 0){
+    for(i = 0; i < n; i++){
+      if(ev[i].pid != getpid() || ev[i].a != SYS_getpid)
+        continue;
+      if(ev[i].type == TR_SYSCALL)
+        calls++;
+      if(ev[i].type == TR_SYSRET && ev[i].b == getpid())
+        rets++;
+    }
+  }
+  if(n < 0 || calls != 5 || rets != 5){
+    printf("%s: %d getpid calls and %d returns traced\n", s, calls, rets);
+    exit(1);
+  }
+}
+
+// getrusage() should see time spent spinning, in this process
+// and in a waited-for child, and procinfo() should list this one.
+void
+rusagetest(char *s)
+{
+  struct rusage ru;
+  static struct procinfo pi[NPROC];
+  int i, n, pid, t0;
+  volatile int x = 0;
+
+  t0 = uptime();
+  while(uptime() - t0 < 2)
+    x++;
+  if(getrusage(RUSAGE_SELF, &ru) < 0 || ru.utime == 0){
+    printf("%s: no user time after spinning\n", s);
+    exit(1);
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    t0 = uptime();
+    while(uptime() - t0 < 2)
+      x++;
+    exit(0);
+  }
+  wait(0);
+  if(getrusage(RUSAGE_CHILDREN, &ru) < 0 || ru.utime == 0){
+    printf("%s: no user time for the child\n", s);
+    exit(1);
+  }
+
+  if((n = procinfo(pi, NPROC)) <= 0){
+    printf("%s: procinfo failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < n; i++)
+    if(pi[i].pid == getpid())
+      break;
+  if(i == n || pi[i].ru.utime == 0){
+    printf("%s: procinfo does not show this process\n", s);
+    exit(1);
+  }
+}
+
+// sysstat() should count and time this process's calls.
+void
+sysstattest(char *s)
+{
+  static struct sysstat st[SYS_sysstat+1];
+  uint64 n;
+  int i;
+
+  if(sysstat(SYSSTAT_RESET, 0, 0) != 0){
+    printf("%s: SYSSTAT_RESET failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 10; i++)
+    getpid();
+  if(sysstat(SYSSTAT_READ, st, SYS_sysstat+1) != SYS_sysstat+1){
+    printf("%s: SYSSTAT_READ failed\n", s);
+    exit(1);
+  }
+  n = 0;
+  for(i = 0; i < NSYSHIST; i++)
+    n += st[SYS_getpid].hist[i];
+  if(st[SYS_getpid].count < 10 || n != st[SYS_getpid].count){
+    printf("%s: %d getpid calls, %d in the histogram\n", s,
+           (int)st[SYS_getpid].count, (int)n);
+    exit(1);
+  }
+}
+
+// user code should be able to read the cycle, time and
+// instret counters, and they should advance.
+void
+countertest(char *s)
+{
+  uint64 c0, t0, n0;
+  volatile int i;
+
+  c0 = rdcycle();
+  t0 = rdtime();
+  n0 = rdinstret();
+  for(i = 0; i < 100000; i++)
+    ;
+  if(rdcycle() <= c0 || rdinstret() < n0 + 100000){
+    printf("%s: cycle or instret counter not advancing\n", s);
+    exit(1);
+  }
+  usleep(10000);
+  if(rdtime() - t0 < TIMEFREQ / 100){
+    printf("%s: time counter not advancing\n", s);
+    exit(1);
+  }
+}
+
+// the hardware counters in getrusage() should count a child's
+// instructions, and more for a child that does more.
+void
+hpmtest(char *s)
+{
+  struct rusage r0, r1, r2;
+  volatile int i;
+  int n, pid;
+
+  getrusage(RUSAGE_CHILDREN, &r0);
+  for(n = 1; n <= 2; n++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      for(i = 0; i < n * 1000000; i++)
+        ;
+      exit(0);
+    }
+    wait(0);
+    getrusage(RUSAGE_CHILDREN, n == 1 ? &r1 : &r2);
+  }
+  if(r1.hpm[HPM_INSTRET] - r0.hpm[HPM_INSTRET] < 1000000 ||
+     r2.hpm[HPM_INSTRET] - r1.hpm[HPM_INSTRET] < 2000000 ||
+     r1.hpm[HPM_CYCLE] == r0.hpm[HPM_CYCLE]){
+    printf("%s: children's counters did not advance\n", s);
+    exit(1);
+  }
+}
+
 // test that iput() is called at the end of _namei().
 // also tests empty file names.
 void
@@ -2878,6 +4137,27 @@ main(int argc, char *argv[])
     {fourteen, "fourteen"},
     {bigfile, "bigfile"},
     {dirfile, "dirfile"},
+    {getdentstest, "getdents"},
+    {attest, "attest"},
+    {iovtest, "iovec"},
+    {sendfiletest, "sendfile"},
+    {pcachetest, "pcache"},
+    {fsynctest, "fsync"},
+    {workqtest, "workq"},
+    {clonetest, "clone"},
+    {futextest, "futex"},
+    {gthreadtest, "gthread"},
+    {polltest, "poll"},
+    {nonblocktest, "nonblock"},
+    {uringtest, "uring"},
+    {fallocatetest, "fallocate"},
+    {usleeptest, "usleep"},
+    {proftest, "prof"},
+    {ktracetest, "ktrace"},
+    {rusagetest, "rusage"},
+    {sysstattest, "sysstat"},
+    {countertest, "counters"},
+    {hpmtest, "hpm"},
     {iref, "iref"},
     {forktest, "forktest"},
     {bigdir, "bigdir"}, // slow
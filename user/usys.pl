@@ -36,3 +36,30 @@ entry("getpid");
 entry("sbrk");
 entry("sleep");
 entry("uptime");
+entry("getdents");
+entry("openat");
+entry("mkdirat");
+entry("unlinkat");
+entry("fstatat");
+entry("readv");
+entry("writev");
+entry("pread");
+entry("pwrite");
+entry("sendfile");
+entry("cachestat");
+entry("fsync");
+entry("clone");
+entry("join");
+entry("futex_wait");
+entry("futex_wake");
+entry("poll");
+entry("fcntl");
+entry("uring_setup");
+entry("uring_enter");
+entry("fallocate");
+entry("usleep");
+entry("prof");
+entry("ktrace");
+entry("getrusage");
+entry("procinfo");
+entry("sysstat");
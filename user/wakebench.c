@@ -0,0 +1,66 @@
+// Benchmark waking a process on an idle CPU: two processes bounce
+// a byte through a pair of pipes, so that each spends most of its
+// time asleep and is woken by the other; and one process sleeps
+// over and over for a short time, to be woken by its timer.
+//
+// usage: wakebench [rounds]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Report per-round time in microseconds, from t ms in all.
+void
+report(char *what, int rounds, int t)
+{
+  printf("%s: %d rounds, %d ms, about %d us each\n",
+         what, rounds, t, t * 1000 / rounds);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds, i, t0, pid, ping[2], pong[2];
+  char c;
+
+  rounds = 10000;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(rounds < 1 || rounds > 20000){
+    fprintf(2, "usage: wakebench [rounds, at most 20000]\n");
+    exit(1);
+  }
+
+  if(pipe(ping) < 0 || pipe(pong) < 0){
+    fprintf(2, "wakebench: pipe failed\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "wakebench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < rounds; i++){
+      if(read(ping[0], &c, 1) != 1)
+        exit(1);
+      write(pong[1], &c, 1);
+    }
+    exit(0);
+  }
+  t0 = millis();
+  for(i = 0; i < rounds; i++){
+    write(ping[1], "w", 1);
+    if(read(pong[0], &c, 1) != 1){
+      fprintf(2, "wakebench: read failed\n");
+      exit(1);
+    }
+  }
+  report("pipe round trip", rounds, millis() - t0);
+  wait(0);
+
+  t0 = millis();
+  for(i = 0; i < rounds / 10; i++)
+    usleep(100);
+  report("usleep(100)", rounds / 10, millis() - t0);
+  exit(0);
+}
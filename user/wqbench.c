@@ -0,0 +1,80 @@
+// Benchmark operations whose cleanup the kernel defers to its
+// work queues: unlinking large files, and waiting for processes
+// with a lot of memory to exit.  Reports the time the calling
+// process spends in unlink() and wait().
+//
+// usage: wqbench [rounds]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/fs.h"
+#include "kernel/riscv.h"
+#include "user/user.h"
+
+#define FILEBLK 200               // blocks per file; needs the indirect block
+#define MEMSZ   (16*1024*1024)    // bytes of memory per child
+
+char buf[BSIZE];
+
+int
+main(int argc, char *argv[])
+{
+  int rounds, i, j, fd, t0, tunlink, twait, pfd[2];
+  char *p;
+
+  rounds = 20;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(rounds < 1)
+    rounds = 1;
+
+  memset(buf, 'q', sizeof(buf));
+  tunlink = 0;
+  for(i = 0; i < rounds; i++){
+    if((fd = open("wqbench.dat", O_CREATE|O_WRONLY)) < 0){
+      fprintf(2, "wqbench: cannot create wqbench.dat\n");
+      exit(1);
+    }
+    for(j = 0; j < FILEBLK; j++){
+      if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+        fprintf(2, "wqbench: write failed\n");
+        exit(1);
+      }
+    }
+    close(fd);
+    t0 = millis();
+    unlink("wqbench.dat");
+    tunlink += millis() - t0;
+  }
+  printf("unlink of %d KB file: %d rounds, %d ms in unlink\n",
+         FILEBLK * BSIZE / 1024, rounds, tunlink);
+
+  twait = 0;
+  for(i = 0; i < rounds; i++){
+    if(pipe(pfd) < 0){
+      fprintf(2, "wqbench: pipe failed\n");
+      exit(1);
+    }
+    if(fork() == 0){
+      if((p = sbrk(MEMSZ)) == (char*)-1){
+        fprintf(2, "wqbench: sbrk failed\n");
+        exit(1);
+      }
+      for(j = 0; j < MEMSZ; j += PGSIZE)
+        p[j] = 1;
+      write(pfd[1], "x", 1);
+      exit(0);
+    }
+    // time only the child's exit, not its work.
+    close(pfd[1]);
+    read(pfd[0], buf, 1);
+    close(pfd[0]);
+    t0 = millis();
+    wait(0);
+    twait += millis() - t0;
+  }
+  printf("exit of %d MB process: %d rounds, %d ms in wait\n",
+         MEMSZ / (1024*1024), rounds, twait);
+  exit(0);
+}